@@ -1,8 +1,11 @@
 #pragma once
 #include "Math.h"
+#include "SIMD.h"
 
 namespace dae
 {
+	class ThreadPool;
+
 	//Enums
 	enum class PrimitiveTopology
 	{
@@ -32,6 +35,12 @@ namespace dae
 		ANISOTROPIC,
 	};
 
+	enum class TextureAddressMode
+	{
+		WRAP,
+		CLAMP,
+	};
+
 	enum class EffectType
 	{
 		STANDARD,
@@ -45,6 +54,17 @@ namespace dae
 		DEPTH_BUFFER
 	};
 
+	enum class ClipResult : uint8_t
+	{
+		ACCEPTED,
+		CULLED,
+		CLIPPED
+	};
+
+	//Constants
+	constexpr int RASTER_BLOCK_SIZE{ 8 }; //the software rasterizer walks the screen in blocks of 8x8 pixels
+	constexpr uint32_t INVALID_TRIANGLE_ID{ UINT32_MAX }; //visibility buffer value for pixels no triangle has been written to
+
 	//Structs
 	struct Vertex
 	{
@@ -64,14 +84,144 @@ namespace dae
 		Vector3 viewDirection{};
 	};
 
+	//Transformed vertices split up per attribute, so every stage only streams through the data it reads
+	struct VertexStreams
+	{
+		std::vector<Vector4> clipPositions{};
+		std::vector<Vector2> screenPositions{};
+		std::vector<float> depths{}; //NDC z
+		std::vector<float> invWs{};
+		std::vector<Vector2> uvs{};
+		std::vector<Vector3> normals{};
+		std::vector<Vector3> tangents{};
+		std::vector<Vector3> viewDirections{};
+
+		size_t GetSize() const { return clipPositions.size(); }
+		void Resize(const size_t nrVertices)
+		{
+			clipPositions.resize(nrVertices);
+			screenPositions.resize(nrVertices);
+			depths.resize(nrVertices);
+			invWs.resize(nrVertices);
+			uvs.resize(nrVertices);
+			normals.resize(nrVertices);
+			tangents.resize(nrVertices);
+			viewDirections.resize(nrVertices);
+		}
+	};
+
+	//VertexOut for a group of pixels, one pixel per SIMD lane
+	struct VertexOutN
+	{
+		SIMD::Vector2N uv{};
+		SIMD::Vector2N uvDdx{}; //how far uv moves to the next pixel in x, the same for the 4 pixels of a 2x2 quad
+		SIMD::Vector2N uvDdy{};
+		SIMD::Vector3N normal{};
+		SIMD::Vector3N tangent{};
+		SIMD::Vector3N viewDirection{};
+	};
+
+	struct AttributePlane
+	{
+		//value at the center of the triangle's reference pixel, and how much it changes per pixel
+		float origin{};
+		float stepX{};
+		float stepY{};
+
+		//x & y are relative to the reference pixel
+		float Evaluate(const float x, const float y) const { return origin + stepX * x + stepY * y; }
+		SIMD::FloatN Evaluate(const SIMD::FloatN& x, const SIMD::FloatN& y) const { return SIMD::Set1(origin) + SIMD::Set1(stepX) * x + SIMD::Set1(stepY) * y; }
+	};
+
+	struct TriangleSetup
+	{
+		uint32_t V0Idx{};
+		uint32_t V1Idx{};
+		uint32_t V2Idx{};
+
+		//fixed-point edge functions, edge i is opposite of vertex i
+		int64_t edgeOrigin[3]{}; //biased value at the center of pixel (0, 0)
+		int64_t edgeStepX[3]{};
+		int64_t edgeStepY[3]{};
+
+		//plane equations in SCREEN space, relative to the center of the reference pixel
+		Int2 planeOrigin{};
+		AttributePlane depthPlane{}; //NDC z is linear in SCREEN space
+		AttributePlane invWPlane{};
+		AttributePlane uvPlanes[2]{}; //attributes are divided by w, so they can be interpolated linearly too
+		AttributePlane normalPlanes[3]{};
+		AttributePlane tangentPlanes[3]{};
+		AttributePlane viewDirectionPlanes[3]{};
+
+		//clamped bounding box in pixels, max is exclusive
+		Int2 minBoundingBox{};
+		Int2 maxBoundingBox{};
+
+		//closest depth of the three vertices, used for HiZ rejection
+		float minDepth{};
+	};
+
+	struct SoftwareRenderingStats
+	{
+		uint32_t nrHiZRejectedTriangles{}; //whole triangles at setup, or the part of a triangle inside a tile
+		uint32_t nrHiZRejectedBlocks{};
+		uint32_t nrShadedPixels{};
+
+		//frustum handling, clipped triangles are replaced by the pieces that remain after clipping
+		uint32_t nrAcceptedTriangles{};
+		uint32_t nrClippedTriangles{};
+		uint32_t nrCulledTriangles{};
+
+		//whole meshlets culled against the frustum or their normal cone before their vertices get transformed
+		uint32_t nrMeshlets{};
+		uint32_t nrCulledMeshlets{};
+		uint32_t nrMeshletCulledTriangles{};
+
+		//vertex transform, lazily transformed meshes only do the vertices of triangles that survived culling
+		uint32_t nrVertices{};
+		uint32_t nrTransformedPositions{};
+		uint32_t nrTransformedAttributes{};
+	};
+
+	//Software counterpart of D3D11_SAMPLER_DESC, filters & addresses like the hardware sampler of the same SamplerState
+	struct SoftwareSampler
+	{
+		SamplerState filter{ SamplerState::POINT };
+		TextureAddressMode addressMode{ TextureAddressMode::WRAP };
+		int maxAnisotropy{ 16 };
+	};
+
 	struct SoftwareRenderingInfo
 	{
 		Int2 screenSize{};
 		SDL_Surface* pBackBuffer{};
 		uint32_t* pBackBufferPixels{};
 		float* pDepthBufferPixels{};
+		float* pHiZBufferPixels{}; //max depth of every RASTER_BLOCK_SIZE x RASTER_BLOCK_SIZE block of the depth buffer
+		uint32_t* pTriangleIdBufferPixels{}; //visibility buffer, index of the closest triangle of the mesh being rendered
 		ShadingMode shadingMode{};
 		bool isUsingNormalMap{};
 		SoftwareRenderingState SRState{ SoftwareRenderingState::DEFAULT };
+		bool isUsingVisibilityBuffer{}; //rasterize depth & triangle ids first, then shade every visible pixel once
+		ThreadPool* pThreadPool{};
+		int tileSize{ 64 };
+		uint32_t nrThreads{ 1 };
+		SoftwareRenderingStats stats{};
+	};
+
+	//Pipeline state the software raster kernels are specialized on, fixed for a whole draw
+	template<CullMode cullModeT, SoftwareRenderingState SRStateT, ShadingMode shadingModeT, bool isUsingNormalMapT>
+	struct RasterKernelConfig
+	{
+		static constexpr CullMode cullMode{ cullModeT };
+		static constexpr SoftwareRenderingState SRState{ SRStateT };
+		static constexpr ShadingMode shadingMode{ shadingModeT };
+		static constexpr bool isUsingNormalMap{ isUsingNormalMapT };
+
+		//attributes that have to be interpolated, everything else is skipped from setup to shading
+		static constexpr bool isShading{ SRState == SoftwareRenderingState::DEFAULT };
+		static constexpr bool isUsingUV{ isShading && (isUsingNormalMap || shadingMode != ShadingMode::OBSERVED_AREA) };
+		static constexpr bool isUsingTangent{ isShading && isUsingNormalMap };
+		static constexpr bool isUsingViewDirection{ isShading && (shadingMode == ShadingMode::SPECULAR || shadingMode == ShadingMode::COMBINED) };
 	};
 }
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0)
+			return;
+
+		m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_hMapping)
+			return;
+
+		m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_pData)
+		{
+			m_Size = static_cast<size_t>(fileSize.QuadPart);
+		}
+	}
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+		if (m_hMapping)
+			CloseHandle(m_hMapping);
+		if (m_hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(m_hFile);
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_FileDescriptor = open(path.c_str(), O_RDONLY);
+		if (m_FileDescriptor < 0)
+			return;
+
+		struct stat fileInfo {};
+		if (fstat(m_FileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0)
+			return;
+
+		void* pMapping{ mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0) };
+		if (pMapping == MAP_FAILED)
+			return;
+
+		m_pData = static_cast<const char*>(pMapping);
+		m_Size = static_cast<size_t>(fileInfo.st_size);
+	}
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+			munmap(const_cast<char*>(m_pData), m_Size);
+		if (m_FileDescriptor >= 0)
+			close(m_FileDescriptor);
+	}
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace dae
+{
+	//Read-only view of a whole file, the OS pages it in on demand instead of copying it into a buffer first
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		//empty files can't be mapped, so those are reported as invalid as well
+		bool IsValid() const { return m_pData != nullptr; }
+
+		const char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE m_hFile{ INVALID_HANDLE_VALUE };
+		HANDLE m_hMapping{};
+#else
+		int m_FileDescriptor{ -1 };
+#endif
+
+		const char* m_pData{};
+		size_t m_Size{};
+	};
+}
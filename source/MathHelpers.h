@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 
 namespace dae
 {
@@ -10,6 +11,12 @@ namespace dae
 		int y{};
 	};
 
+	struct Int64_2
+	{
+		int64_t x{};
+		int64_t y{};
+	};
+
 	/* --- CONSTANTS --- */
 	constexpr auto PI = 3.14159265358979323846f;
 	constexpr auto PI_DIV_2 = 1.57079632679489661923f;
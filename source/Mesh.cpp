@@ -1,16 +1,24 @@
 #include "pch.h"
+#include <array>
 #include "Mesh.h"
+#include "MeshData.h"
 #include "Texture.h"
+#include "ThreadPool.h"
+#include "SIMD.h"
 #include "Effect.h"
 #include "EffectStandard.h"
 #include "EffectTransparent.h"
 
 namespace dae
 {
-	Mesh::Mesh(ID3D11Device* pDevice, const EffectType effectType, const std::wstring& effectFilename, const std::vector<Vertex>&& vertices, const std::vector<uint32_t>&& indices)
-		: m_EffectType{ effectType }
-		, m_Vertices{ vertices }
-		, m_Indices{ indices }
+	Mesh::Mesh(ID3D11Device* pDevice, const EffectType effectType, const std::wstring& effectFilename, MeshData* pMeshData)
+		: m_Lods{ pMeshData->GetLods() }
+		, m_EffectType{ effectType }
+		, m_pMeshData{ pMeshData }
+		, m_Vertices{ pMeshData->GetVertices() }
+		, m_Indices{ pMeshData->GetIndices() }
+		, m_Meshlets{ pMeshData->GetMeshlets() }
+		, m_MeshletVertices{ pMeshData->GetMeshletVertices() }
 	{
 		//Create the Effect based on effect type
 		switch (m_EffectType)
@@ -36,6 +44,12 @@ namespace dae
 		if (FAILED(CreateLayouts(pDevice)))
 			return;
 
+		//Start out at the full mesh, the index buffer holds every level
+		if (!m_Lods.empty())
+		{
+			SetLod(0);
+		}
+
 		//Create buffers
 		if (FAILED(CreateBuffers(pDevice)))
 			return;
@@ -52,11 +66,13 @@ namespace dae
 			m_pVertexBuffer->Release();
 
 		delete m_pEffect;
+		delete m_pMeshData;
 
 		delete m_pDiffuseTexture;
 		delete m_pNormalTexture;
 		delete m_pSpecularTexture;
 		delete m_pGlossinessTexture;
+		delete m_pMaterialTexture;
 	}
 
 	HRESULT Mesh::CreateLayouts(ID3D11Device* pDevice)
@@ -80,14 +96,15 @@ namespace dae
 		if (FAILED(result))
 			return result;
 
-		//Create index buffer
+		//Create index buffer, with the indices of all levels of detail
+		const std::span<const uint32_t> allIndices{ m_pMeshData->GetIndices() };
 		m_NumIndices = static_cast<uint32_t>(m_Indices.size());
 		bd.Usage = D3D11_USAGE_IMMUTABLE;
-		bd.ByteWidth = sizeof(uint32_t) * m_NumIndices;
+		bd.ByteWidth = sizeof(uint32_t) * static_cast<uint32_t>(allIndices.size());
 		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		bd.CPUAccessFlags = 0;
 		bd.MiscFlags = 0;
-		initData.pSysMem = m_Indices.data();
+		initData.pSysMem = allIndices.data();
 
 		result = pDevice->CreateBuffer(&bd, &initData, &m_pIndexBuffer);
 		
@@ -125,36 +142,47 @@ namespace dae
 		for (UINT p{ 0 }; p < techDesc.Passes; ++p)
 		{
 			m_pTechnique->GetPassByIndex(p)->Apply(0, pDeviceContext);
-			pDeviceContext->DrawIndexed(m_NumIndices, 0, 0);
+			pDeviceContext->DrawIndexed(m_NumIndices, m_StartIndex, 0);
 		}
 	}
-	void Mesh::RenderSoftware(SoftwareRenderingInfo& SRInfo) const
+	template<size_t kernelIdx>
+	constexpr Mesh::RenderKernel Mesh::GetRenderKernel()
 	{
-		//Handle Primitive Topology Type
-		switch (m_PrimitiveTopology)
-		{
-		case PrimitiveTopology::TRIANGLE_LIST:
-		{
-			//Loop Over All Triangles
-			for (size_t verticeIdx{}; verticeIdx < m_Indices.size(); verticeIdx += 3)
-			{
-				RenderTriangle(verticeIdx, SRInfo);
-			}
+		constexpr CullMode cullMode{ static_cast<CullMode>(kernelIdx / (m_NrSRStates * m_NrShadingModes * 2)) };
+		constexpr SoftwareRenderingState SRState{ static_cast<SoftwareRenderingState>(kernelIdx / (m_NrShadingModes * 2) % m_NrSRStates) };
 
-			break;
-		}
+		//shading mode & normal map only matter when shading, all other states share a single kernel per cull mode
+		constexpr bool isShading{ SRState == SoftwareRenderingState::DEFAULT };
+		constexpr ShadingMode shadingMode{ isShading ? static_cast<ShadingMode>(kernelIdx / 2 % m_NrShadingModes) : ShadingMode::OBSERVED_AREA };
+		constexpr bool isUsingNormalMap{ isShading && kernelIdx % 2 == 1 };
 
-		case PrimitiveTopology::TRIANGLE_STRIP:
+		return &Mesh::RenderSoftwareKernel<RasterKernelConfig<cullMode, SRState, shadingMode, isUsingNormalMap>>;
+	}
+	void Mesh::RenderSoftware(SoftwareRenderingInfo& SRInfo)
+	{
+		SRInfo.stats.nrAcceptedTriangles += m_ClipStats.nrAcceptedTriangles;
+		SRInfo.stats.nrClippedTriangles += m_ClipStats.nrClippedTriangles;
+		SRInfo.stats.nrCulledTriangles += m_ClipStats.nrCulledTriangles;
+		SRInfo.stats.nrMeshlets += m_ClipStats.nrMeshlets;
+		SRInfo.stats.nrCulledMeshlets += m_ClipStats.nrCulledMeshlets;
+		SRInfo.stats.nrMeshletCulledTriangles += m_ClipStats.nrMeshletCulledTriangles;
+		SRInfo.stats.nrVertices += m_ClipStats.nrVertices;
+		SRInfo.stats.nrTransformedPositions += m_ClipStats.nrTransformedPositions;
+		SRInfo.stats.nrTransformedAttributes += m_ClipStats.nrTransformedAttributes;
+
+		//every combination of pipeline state gets its own kernel, so the per pixel code never has to branch on it
+		static constexpr auto renderKernels{ []<size_t... kernelIndices>(std::index_sequence<kernelIndices...>)
 		{
-			//Loop Over All Triangles
-			for (size_t verticeIdx{}; verticeIdx < m_Indices.size() - 2; ++verticeIdx)
-			{
-				RenderTriangle(verticeIdx, SRInfo, verticeIdx % 2);
-			}
+			return std::array<RenderKernel, sizeof...(kernelIndices)>{ GetRenderKernel<kernelIndices>()... };
+		}(std::make_index_sequence<m_NrRenderKernels>{}) };
 
-			break;
-		}
-		}
+		const size_t kernelIdx
+		{
+			((static_cast<size_t>(m_CullMode) * m_NrSRStates + static_cast<size_t>(SRInfo.SRState)) * m_NrShadingModes + static_cast<size_t>(SRInfo.shadingMode)) * 2
+			+ (SRInfo.isUsingNormalMap ? 1 : 0)
+		};
+
+		(this->*renderKernels[kernelIdx])(SRInfo);
 	}
 
 	void Mesh::InitializeTransform(const Vector3& translation, const Vector3& rotation, const Vector3& scale)
@@ -193,391 +221,1324 @@ namespace dae
 		return m_ScaleMatrix * m_RotationMatrix * m_TranslationMatrix;
 	}
 
+	void Mesh::UpdateLod(const Matrix& viewMatrix, const Matrix& projMatrix, const int screenHeight)
+	{
+		//strips can't be cut into ranges, meshes that weren't optimized only have the one level anyway
+		if (m_Lods.size() < 2 || m_PrimitiveTopology != PrimitiveTopology::TRIANGLE_LIST)
+			return;
+
+		//bounding sphere in VIEW space, the errors scale along with its largest axis
+		const Matrix worldMatrix{ GetWorldMatrix() };
+		const MeshBounds& bounds{ m_pMeshData->GetBounds() };
+		const float maxScale{ std::max({ worldMatrix.GetAxisX().Magnitude(), worldMatrix.GetAxisY().Magnitude(), worldMatrix.GetAxisZ().Magnitude() }) };
+
+		const Vector3 viewCenter{ viewMatrix.TransformPoint(worldMatrix.TransformPoint((bounds.min + bounds.max) * 0.5f)) };
+		const float radius{ (bounds.max - bounds.min).Magnitude() * 0.5f * maxScale };
+
+		//measured at the nearest point of the sphere, a camera inside of it always gets the full mesh
+		const float nearestDepth{ viewCenter.z - radius };
+		if (nearestDepth <= 0.f)
+		{
+			SetLod(0);
+			return;
+		}
+
+		//object space error => pixels, projMatrix[1].y is 1 / tan(fov / 2)
+		const float pixelsPerUnit{ maxScale * projMatrix[1].y * static_cast<float>(screenHeight) * 0.5f / nearestDepth };
+
+		uint32_t lodIdx{};
+		for (uint32_t i{ 1 }; i < m_Lods.size(); ++i)
+		{
+			const float maxPixelError{ i > m_LodIdx ? m_LodPixelError * m_LodHysteresis : m_LodPixelError };
+			if (m_Lods[i].error * pixelsPerUnit > maxPixelError)
+				break;
+
+			lodIdx = i;
+		}
+
+		SetLod(lodIdx);
+	}
+	void Mesh::SetLod(const uint32_t lodIdx)
+	{
+		const MeshLod& lod{ m_Lods[lodIdx] };
+		m_LodIdx = lodIdx;
+
+		//DirectX draws the range out of the index buffer holding every level, Software renders the spans directly
+		m_StartIndex = lod.firstIndex;
+		m_NumIndices = lod.nrIndices;
+		m_Indices = m_pMeshData->GetIndices().subspan(lod.firstIndex, lod.nrIndices);
+		m_Meshlets = m_pMeshData->GetMeshlets().subspan(lod.firstMeshlet, lod.nrMeshlets);
+	}
+
 #pragma region Software Rendering
-	void Mesh::RenderTriangle(const size_t idx, SoftwareRenderingInfo& SRInfo, const bool shouldSwapVertices) const
+	template<typename Config>
+	void Mesh::RenderSoftwareKernel(SoftwareRenderingInfo& SRInfo)
 	{
-		//store the indexes of current triangle vertices
-		const size_t V0Idx{ m_Indices[idx] };
-		const size_t V1Idx{ m_Indices[idx + 1 + shouldSwapVertices] };
-		const size_t V2Idx{ m_Indices[idx + 1 + !shouldSwapVertices] };
+		//Mesh triangles followed by the pieces of the clipped ones
+		const size_t nrMeshTriangles{ GetNrTriangles() };
+		const size_t nrTriangles{ nrMeshTriangles + m_ClippedIndices.size() / 3 };
+
+		//Divide the screen in tiles, tiles are made of whole blocks so a HiZ block is never shared between threads
+		const int tileSize{ (std::max(SRInfo.tileSize, 1) + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE * RASTER_BLOCK_SIZE };
+		const int nrTilesX{ (SRInfo.screenSize.x + tileSize - 1) / tileSize };
+		const int nrTilesY{ (SRInfo.screenSize.y + tileSize - 1) / tileSize };
+		const uint32_t nrTiles{ static_cast<uint32_t>(nrTilesX * nrTilesY) };
+
+		const uint32_t nrChunks{ static_cast<uint32_t>((nrTriangles + m_BinningChunkSize - 1) / m_BinningChunkSize) };
+
+		m_TriangleSetups.resize(nrTriangles);
+		m_TileBins.resize(static_cast<size_t>(nrChunks) * nrTiles);
+
+		//1. Setup & bin triangles, every chunk keeps its own bins so no two threads ever write the same list
+		SRInfo.pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIdx)
+			{
+				std::vector<uint32_t>* pChunkBins{ &m_TileBins[static_cast<size_t>(chunkIdx) * nrTiles] };
+				for (uint32_t tileIdx{}; tileIdx < nrTiles; ++tileIdx)
+				{
+					pChunkBins[tileIdx].clear();
+				}
+
+				SoftwareRenderingStats chunkStats{};
+
+				const size_t firstTriangle{ static_cast<size_t>(chunkIdx) * m_BinningChunkSize };
+				const size_t lastTriangle{ std::min(firstTriangle + m_BinningChunkSize, nrTriangles) };
+
+				for (size_t triangleIdx{ firstTriangle }; triangleIdx < lastTriangle; ++triangleIdx)
+				{
+					TriangleSetup& triangle{ m_TriangleSetups[triangleIdx] };
+
+					//culled triangles and the originals of clipped ones are never rasterized
+					if (triangleIdx < nrMeshTriangles && m_ClipResults[triangleIdx] != ClipResult::ACCEPTED)
+						continue;
+
+					uint32_t V0Idx{}, V1Idx{}, V2Idx{};
+					GetTriangleIndices(triangleIdx, V0Idx, V1Idx, V2Idx);
+
+					if (!SetupTriangle<Config>(V0Idx, V1Idx, V2Idx, SRInfo, triangle, chunkStats))
+						continue;
+
+					//the whole triangle is behind what has been drawn already
+					if (IsOccludedByHiZ(triangle, Int2{}, SRInfo.screenSize, SRInfo))
+					{
+						++chunkStats.nrHiZRejectedTriangles;
+						continue;
+					}
+
+					//add triangle to every tile its bounding box touches
+					const int minTileX{ triangle.minBoundingBox.x / tileSize };
+					const int minTileY{ triangle.minBoundingBox.y / tileSize };
+					const int maxTileX{ (triangle.maxBoundingBox.x - 1) / tileSize };
+					const int maxTileY{ (triangle.maxBoundingBox.y - 1) / tileSize };
+
+					for (int tileY{ minTileY }; tileY <= maxTileY; ++tileY)
+					{
+						for (int tileX{ minTileX }; tileX <= maxTileX; ++tileX)
+						{
+							pChunkBins[tileY * nrTilesX + tileX].push_back(static_cast<uint32_t>(triangleIdx));
+						}
+					}
+				}
+
+				std::atomic_ref{ SRInfo.stats.nrHiZRejectedTriangles } += chunkStats.nrHiZRejectedTriangles;
+				std::atomic_ref{ SRInfo.stats.nrTransformedAttributes } += chunkStats.nrTransformedAttributes;
+			}, SRInfo.nrThreads);
+
+		//2. Rasterize tiles, each tile is owned by exactly one thread and walks the chunks in submission order
+		SRInfo.pThreadPool->ParallelFor(nrTiles, [&](uint32_t tileIdx)
+			{
+				const int tileX{ static_cast<int>(tileIdx) % nrTilesX };
+				const int tileY{ static_cast<int>(tileIdx) / nrTilesX };
+
+				const Int2 tileMin{ tileX * tileSize, tileY * tileSize };
+				const Int2 tileMax{ std::min(tileMin.x + tileSize, SRInfo.screenSize.x), std::min(tileMin.y + tileSize, SRInfo.screenSize.y) };
+
+				SoftwareRenderingStats tileStats{};
+
+				for (uint32_t chunkIdx{}; chunkIdx < nrChunks; ++chunkIdx)
+				{
+					for (const uint32_t triangleIdx : m_TileBins[static_cast<size_t>(chunkIdx) * nrTiles + tileIdx])
+					{
+						const TriangleSetup& triangle{ m_TriangleSetups[triangleIdx] };
+
+						//the part of the triangle inside this tile is hidden by earlier triangles
+						if (IsOccludedByHiZ(triangle, tileMin, tileMax, SRInfo))
+						{
+							++tileStats.nrHiZRejectedTriangles;
+							continue;
+						}
+
+						RenderTriangle<Config>(triangleIdx, tileMin, tileMax, SRInfo, tileStats);
+					}
+				}
+
+				//all triangles of the tile are in, shade what ended up visible
+				if constexpr (Config::SRState != SoftwareRenderingState::BOUNDING_BOXES)
+				{
+					if (SRInfo.isUsingVisibilityBuffer)
+					{
+						ResolveVisibilityBuffer<Config>(tileMin, tileMax, SRInfo, tileStats);
+					}
+				}
+
+				std::atomic_ref{ SRInfo.stats.nrHiZRejectedTriangles } += tileStats.nrHiZRejectedTriangles;
+				std::atomic_ref{ SRInfo.stats.nrHiZRejectedBlocks } += tileStats.nrHiZRejectedBlocks;
+				std::atomic_ref{ SRInfo.stats.nrShadedPixels } += tileStats.nrShadedPixels;
+			}, SRInfo.nrThreads);
+	}
+
+	size_t Mesh::GetNrTriangles() const
+	{
+		//Handle Primitive Topology Type
+		switch (m_PrimitiveTopology)
+		{
+		case PrimitiveTopology::TRIANGLE_LIST:
+			return m_Indices.size() / 3;
+
+		case PrimitiveTopology::TRIANGLE_STRIP:
+			return (m_Indices.size() > 2) ? m_Indices.size() - 2 : 0;
+		}
+
+		return 0;
+	}
+	void Mesh::GetTriangleIndices(const size_t triangleIdx, uint32_t& V0Idx, uint32_t& V1Idx, uint32_t& V2Idx) const
+	{
+		const size_t nrMeshTriangles{ GetNrTriangles() };
+
+		//pieces of clipped triangles are always stored as a list
+		if (triangleIdx >= nrMeshTriangles)
+		{
+			const size_t idx{ (triangleIdx - nrMeshTriangles) * 3 };
+
+			V0Idx = m_ClippedIndices[idx];
+			V1Idx = m_ClippedIndices[idx + 1];
+			V2Idx = m_ClippedIndices[idx + 2];
+			return;
+		}
+
+		switch (m_PrimitiveTopology)
+		{
+		case PrimitiveTopology::TRIANGLE_LIST:
+		{
+			const size_t idx{ triangleIdx * 3 };
+
+			V0Idx = m_Indices[idx];
+			V1Idx = m_Indices[idx + 1];
+			V2Idx = m_Indices[idx + 2];
+			break;
+		}
+
+		case PrimitiveTopology::TRIANGLE_STRIP:
+		{
+			//every odd triangle has its winding flipped
+			const bool shouldSwapVertices{ triangleIdx % 2 == 1 };
+
+			V0Idx = m_Indices[triangleIdx];
+			V1Idx = m_Indices[triangleIdx + 1 + shouldSwapVertices];
+			V2Idx = m_Indices[triangleIdx + 1 + !shouldSwapVertices];
+			break;
+		}
+		}
+	}
 
+	template<typename Config>
+	bool Mesh::SetupTriangle(const uint32_t V0Idx, const uint32_t V1Idx, const uint32_t V2Idx, const SoftwareRenderingInfo& SRInfo, TriangleSetup& triangle, SoftwareRenderingStats& stats)
+	{
 		//check if the triangle has 3 different vertices
 		if (V0Idx == V1Idx || V1Idx == V2Idx || V2Idx == V0Idx)
-			return;
+			return false;
 
-		//store triangle vertices in NDC space
-		const VertexOut V0NDC{ m_VerticesOut[V0Idx] };
-		const VertexOut V1NDC{ m_VerticesOut[V1Idx] };
-		const VertexOut V2NDC{ m_VerticesOut[V2Idx] };
+		//snap triangle vertices in SCREEN space to the sub-pixel grid
+		const Int64_2 V0Fixed{ ToFixedPoint(m_VertexStreams.screenPositions[V0Idx]) };
+		const Int64_2 V1Fixed{ ToFixedPoint(m_VertexStreams.screenPositions[V1Idx]) };
+		const Int64_2 V2Fixed{ ToFixedPoint(m_VertexStreams.screenPositions[V2Idx]) };
 
-		//check if any vertice of the current triangle is outside the frustum
-		if (!IsVerticeInFrustum(V0NDC))
-			return;
-		if (!IsVerticeInFrustum(V1NDC))
-			return;
-		if (!IsVerticeInFrustum(V2NDC))
-			return;
+		//calculate (twice) the signed triangle area on the snapped vertices
+		int64_t triangleArea{ (V1Fixed.x - V0Fixed.x) * (V2Fixed.y - V1Fixed.y) - (V1Fixed.y - V0Fixed.y) * (V2Fixed.x - V1Fixed.x) };
+
+		//handle culling once per triangle instead of per pixel
+		if (triangleArea == 0)
+			return false;
+
+		if constexpr (Config::cullMode == CullMode::BACK)
+		{
+			if (triangleArea < 0) return false;
+		}
+		else if constexpr (Config::cullMode == CullMode::FRONT)
+		{
+			if (triangleArea > 0) return false;
+		}
+
+		//flip counter-clockwise triangles so every edge function is positive on the inside
+		const int64_t orientation{ (triangleArea > 0) ? 1 : -1 };
+		triangleArea *= orientation;
+
+		//calculate edge functions, edge i is the one opposite of vertex i so it directly gives the weight of vertex i
+		const Int64_2* pEdgeStarts[3]{ &V1Fixed, &V2Fixed, &V0Fixed };
+		const Int64_2* pEdgeEnds[3]{ &V2Fixed, &V0Fixed, &V1Fixed };
+
+		int64_t edgeBias[3]{};
+
+		for (int edgeIdx{}; edgeIdx < 3; ++edgeIdx)
+		{
+			const Int64_2& start{ *pEdgeStarts[edgeIdx] };
+			const Int64_2& end{ *pEdgeEnds[edgeIdx] };
+
+			//E(p) = (end - start) x (p - start) = stepX * p.x + stepY * p.y + constant
+			const int64_t stepX{ (start.y - end.y) * orientation };
+			const int64_t stepY{ (end.x - start.x) * orientation };
+
+			//top-left fill rule: pixels exactly on an edge only belong to the triangle if it's a top or left edge
+			const bool isTopLeftEdge{ stepX > 0 || (stepX == 0 && stepY > 0) };
+			edgeBias[edgeIdx] = isTopLeftEdge ? 0 : 1;
+
+			//evaluate at the center of pixel (0, 0), the bias turns "E > 0 || (E == 0 && topLeft)" into "E >= 0"
+			constexpr int64_t halfPixel{ m_SubPixelScale / 2 };
+			triangle.edgeOrigin[edgeIdx] = stepX * (halfPixel - start.x) + stepY * (halfPixel - start.y) - edgeBias[edgeIdx];
+
+			//step one pixel instead of one sub-pixel
+			triangle.edgeStepX[edgeIdx] = stepX * m_SubPixelScale;
+			triangle.edgeStepY[edgeIdx] = stepY * m_SubPixelScale;
+		}
 
-		//store triangle vertices in SCREEN space
-		const Vector2 V0Screen{ m_VerticesScreenSpace[V0Idx] };
-		const Vector2 V1Screen{ m_VerticesScreenSpace[V1Idx] };
-		const Vector2 V2Screen{ m_VerticesScreenSpace[V2Idx] };
+		//calculate triangle bounding box, only pixels with their center inside the box can be covered
+		const int64_t minFixedX{ std::min({ V0Fixed.x, V1Fixed.x, V2Fixed.x }) };
+		const int64_t minFixedY{ std::min({ V0Fixed.y, V1Fixed.y, V2Fixed.y }) };
+		const int64_t maxFixedX{ std::max({ V0Fixed.x, V1Fixed.x, V2Fixed.x }) };
+		const int64_t maxFixedY{ std::max({ V0Fixed.y, V1Fixed.y, V2Fixed.y }) };
 
-		//calculate triangle edges
-		const Vector2 edgeV0V1{ V1Screen - V0Screen };
-		const Vector2 edgeV1V2{ V2Screen - V1Screen };
-		const Vector2 edgeV2V0{ V0Screen - V2Screen };
+		triangle.minBoundingBox.x = static_cast<int>(std::clamp<int64_t>((minFixedX + m_SubPixelScale / 2 - 1) >> m_SubPixelBits, 0, SRInfo.screenSize.x));
+		triangle.minBoundingBox.y = static_cast<int>(std::clamp<int64_t>((minFixedY + m_SubPixelScale / 2 - 1) >> m_SubPixelBits, 0, SRInfo.screenSize.y));
+		triangle.maxBoundingBox.x = static_cast<int>(std::clamp<int64_t>(((maxFixedX - m_SubPixelScale / 2) >> m_SubPixelBits) + 1, 0, SRInfo.screenSize.x));
+		triangle.maxBoundingBox.y = static_cast<int>(std::clamp<int64_t>(((maxFixedY - m_SubPixelScale / 2) >> m_SubPixelBits) + 1, 0, SRInfo.screenSize.y));
 
-		//calculate inverse of triangle area ( 1 / triangle area)
-		const float invTriangleArea{ 1.f / Vector2::Cross(edgeV0V1, edgeV1V2) };
+		//nothing to rasterize
+		if (triangle.minBoundingBox.x >= triangle.maxBoundingBox.x || triangle.minBoundingBox.y >= triangle.maxBoundingBox.y)
+			return false;
+
+		triangle.V0Idx = V0Idx;
+		triangle.V1Idx = V1Idx;
+		triangle.V2Idx = V2Idx;
+
+		const float V0Depth{ m_VertexStreams.depths[V0Idx] };
+		const float V1Depth{ m_VertexStreams.depths[V1Idx] };
+		const float V2Depth{ m_VertexStreams.depths[V2Idx] };
+
+		triangle.minDepth = std::min({ V0Depth, V1Depth, V2Depth });
+
+		//bounding boxes only need the edges & bounds, depth is the only attribute the depth buffer view needs
+		if constexpr (Config::SRState == SoftwareRenderingState::BOUNDING_BOXES)
+			return true;
+
+		//barycentric weights are linear in SCREEN space: weight i = edge i / area, set them up around the first pixel of the bounding box
+		triangle.planeOrigin = triangle.minBoundingBox;
+
+		const double invTriangleArea{ 1.0 / static_cast<double>(triangleArea) };
 
-		//calculate triangle bounding box
-		Vector2 minBoundingBox{ Vector2::Min(V0Screen, Vector2::Min(V1Screen, V2Screen)) };
-		Vector2 maxBoundingBox{ Vector2::Max(V0Screen, Vector2::Max(V1Screen, V2Screen)) };
-		minBoundingBox.Clamp(static_cast<float>(SRInfo.screenSize.x), static_cast<float>(SRInfo.screenSize.y));
-		maxBoundingBox.Clamp(static_cast<float>(SRInfo.screenSize.x), static_cast<float>(SRInfo.screenSize.y));
+		double weightOrigin[3]{};
+		double weightStepX[3]{};
+		double weightStepY[3]{};
+		for (int edgeIdx{}; edgeIdx < 3; ++edgeIdx)
+		{
+			const int64_t unbiasedEdge{ triangle.edgeOrigin[edgeIdx] + edgeBias[edgeIdx] + triangle.edgeStepX[edgeIdx] * triangle.planeOrigin.x + triangle.edgeStepY[edgeIdx] * triangle.planeOrigin.y };
 
-		//add small margin to bounding box
-		constexpr int boxMargin{ 1 };
+			weightOrigin[edgeIdx] = static_cast<double>(unbiasedEdge) * invTriangleArea;
+			weightStepX[edgeIdx] = static_cast<double>(triangle.edgeStepX[edgeIdx]) * invTriangleArea;
+			weightStepY[edgeIdx] = static_cast<double>(triangle.edgeStepY[edgeIdx]) * invTriangleArea;
+		}
 
-		const int minX{ std::clamp(static_cast<int>(minBoundingBox.x) - boxMargin, 0, SRInfo.screenSize.x) };
-		const int minY{ std::clamp(static_cast<int>(minBoundingBox.y) - boxMargin, 0, SRInfo.screenSize.y) };
-		const int maxX{ std::clamp(static_cast<int>(maxBoundingBox.x) + boxMargin, 0, SRInfo.screenSize.x) };
-		const int maxY{ std::clamp(static_cast<int>(maxBoundingBox.y) + boxMargin, 0, SRInfo.screenSize.y) };
+		const auto calculatePlane{ [&](const float V0Value, const float V1Value, const float V2Value)
+		{
+			return AttributePlane{
+				static_cast<float>(weightOrigin[0] * V0Value + weightOrigin[1] * V1Value + weightOrigin[2] * V2Value),
+				static_cast<float>(weightStepX[0] * V0Value + weightStepX[1] * V1Value + weightStepX[2] * V2Value),
+				static_cast<float>(weightStepY[0] * V0Value + weightStepY[1] * V1Value + weightStepY[2] * V2Value)
+			};
+		} };
 
-		for (int px{ minX }; px < maxX; ++px)
+		//depth is interpolated as is, everything that gets shaded is divided by w for perspective correct interpolation
+		triangle.depthPlane = calculatePlane(V0Depth, V1Depth, V2Depth);
+
+		//only set up the attributes this kernel actually reads
+		if constexpr (!Config::isShading)
+			return true;
+
+		//lazily transformed vertices get their attributes the first time a triangle that made it this far needs them
+		if (m_IsTransformingLazily)
 		{
+			stats.nrTransformedAttributes += RequestAttributes(V0Idx) + RequestAttributes(V1Idx) + RequestAttributes(V2Idx);
+		}
+
+		const float invWV0{ m_VertexStreams.invWs[V0Idx] };
+		const float invWV1{ m_VertexStreams.invWs[V1Idx] };
+		const float invWV2{ m_VertexStreams.invWs[V2Idx] };
+
+		triangle.invWPlane = calculatePlane(invWV0, invWV1, invWV2);
+
+		if constexpr (Config::isUsingUV)
+		{
+			for (int axis{}; axis < 2; ++axis)
+			{
+				triangle.uvPlanes[axis] = calculatePlane(m_VertexStreams.uvs[V0Idx][axis] * invWV0, m_VertexStreams.uvs[V1Idx][axis] * invWV1, m_VertexStreams.uvs[V2Idx][axis] * invWV2);
+			}
+		}
+		for (int axis{}; axis < 3; ++axis)
+		{
+			triangle.normalPlanes[axis] = calculatePlane(m_VertexStreams.normals[V0Idx][axis] * invWV0, m_VertexStreams.normals[V1Idx][axis] * invWV1, m_VertexStreams.normals[V2Idx][axis] * invWV2);
+
+			if constexpr (Config::isUsingTangent)
+			{
+				triangle.tangentPlanes[axis] = calculatePlane(m_VertexStreams.tangents[V0Idx][axis] * invWV0, m_VertexStreams.tangents[V1Idx][axis] * invWV1, m_VertexStreams.tangents[V2Idx][axis] * invWV2);
+			}
+			if constexpr (Config::isUsingViewDirection)
+			{
+				triangle.viewDirectionPlanes[axis] = calculatePlane(m_VertexStreams.viewDirections[V0Idx][axis] * invWV0, m_VertexStreams.viewDirections[V1Idx][axis] * invWV1, m_VertexStreams.viewDirections[V2Idx][axis] * invWV2);
+			}
+		}
+
+		return true;
+	}
+	template<typename Config>
+	void Mesh::RenderTriangle(const uint32_t triangleIdx, const Int2& tileMin, const Int2& tileMax, SoftwareRenderingInfo& SRInfo, SoftwareRenderingStats& stats) const
+	{
+		using namespace SIMD;
+
+		const TriangleSetup& triangle{ m_TriangleSetups[triangleIdx] };
+
+		//only touch the part of the bounding box inside this tile
+		const int minX{ std::max(triangle.minBoundingBox.x, tileMin.x) };
+		const int minY{ std::max(triangle.minBoundingBox.y, tileMin.y) };
+		const int maxX{ std::min(triangle.maxBoundingBox.x, tileMax.x) };
+		const int maxY{ std::min(triangle.maxBoundingBox.y, tileMax.y) };
+
+		//handle showing bounding boxes, ignore any other calculations
+		if constexpr (Config::SRState == SoftwareRenderingState::BOUNDING_BOXES)
+		{
+			constexpr ColorRGB boundingBoxColor{ 1.f, 1.f, 1.f };
+
+			const uint32_t boundingBoxPixel
+			{
+				SDL_MapRGB(SRInfo.pBackBuffer->format,
+					static_cast<uint8_t>(boundingBoxColor.r * 255),
+					static_cast<uint8_t>(boundingBoxColor.g * 255),
+					static_cast<uint8_t>(boundingBoxColor.b * 255))
+			};
+
 			for (int py{ minY }; py < maxY; ++py)
 			{
-				const int pixelIdx{ (py * SRInfo.screenSize.x) + px };
+				std::fill(SRInfo.pBackBufferPixels + (py * SRInfo.screenSize.x) + minX, SRInfo.pBackBufferPixels + (py * SRInfo.screenSize.x) + maxX, boundingBoxPixel);
+			}
+			return;
+		}
 
-				//handle showing bounding boxes
-				if (SRInfo.SRState == SoftwareRenderingState::BOUNDING_BOXES)
-				{
-					constexpr ColorRGB boundingBoxColor{ 1.f, 1.f, 1.f };
+		//per triangle constants, broadcasted to every lane
+		const FloatN depthOrigin{ Set1(triangle.depthPlane.origin) };
+		const FloatN depthStepX{ Set1(triangle.depthPlane.stepX) };
+		const FloatN depthStepY{ Set1(triangle.depthPlane.stepY) };
 
-					SRInfo.pBackBufferPixels[pixelIdx] = SDL_MapRGB(SRInfo.pBackBuffer->format,
-						static_cast<uint8_t>(boundingBoxColor.r * 255),
-						static_cast<uint8_t>(boundingBoxColor.g * 255),
-						static_cast<uint8_t>(boundingBoxColor.b * 255));
+		const Int64N groupStep0{ Set1(triangle.edgeStepX[0] * Width) };
+		const Int64N groupStep1{ Set1(triangle.edgeStepX[1] * Width) };
+		const Int64N groupStep2{ Set1(triangle.edgeStepX[2] * Width) };
 
-					//ignore any other calculations when showing bounding boxes
-					continue;
-				}
+		//depth buffer values of groups running past the end of the block
+		float partialDepths[Width]{};
 
-				const Vector2 currentPixel{ static_cast<float>(px), static_cast<float>(py) };
+		//rasterize the pixels of one block, rows are handled Width pixels at once
+		const auto rasterizeBlock{ [&](const Int2& blockMin, const Int2& blockMax, const int64_t(&blockEdges)[3], const bool isFullyCovered)
+		{
+			bool hasWrittenDepth{ false };
 
-				//check if pixel is in triangle
-				const Vector2 V0ToPixel{ currentPixel - V0Screen };
-				const Vector2 V1ToPixel{ currentPixel - V1Screen };
-				const Vector2 V2ToPixel{ currentPixel - V2Screen };
+			int64_t rowEdge0{ blockEdges[0] };
+			int64_t rowEdge1{ blockEdges[1] };
+			int64_t rowEdge2{ blockEdges[2] };
 
-				//check if pixel is to the right side of all edges
-				const float edge1Cross{ Vector2::Cross(edgeV0V1, V0ToPixel) };
-				const float edge2Cross{ Vector2::Cross(edgeV1V2, V1ToPixel) };
-				const float edge3Cross{ Vector2::Cross(edgeV2V0, V2ToPixel) };
+			for (int py{ blockMin.y }; py < blockMax.y; ++py)
+			{
+				Int64N edge0{ Ramp(rowEdge0, triangle.edgeStepX[0]) };
+				Int64N edge1{ Ramp(rowEdge1, triangle.edgeStepX[1]) };
+				Int64N edge2{ Ramp(rowEdge2, triangle.edgeStepX[2]) };
 
-				if (!IsCrossCheckValid(edge1Cross, edge2Cross, edge3Cross))
-					continue;
+				rowEdge0 += triangle.edgeStepY[0];
+				rowEdge1 += triangle.edgeStepY[1];
+				rowEdge2 += triangle.edgeStepY[2];
 
-				//calculate barycentric weights
-				const float weightV0{ edge2Cross * invTriangleArea };
-				const float weightV1{ edge3Cross * invTriangleArea };
-				const float weightV2{ edge1Cross * invTriangleArea };
+				const FloatN planeY{ Set1(static_cast<float>(py - triangle.planeOrigin.y)) };
 
-				//calculate depth for current pixel
-				const float invDepthV0{ 1.f / V0NDC.position.z };
-				const float invDepthV1{ 1.f / V1NDC.position.z };
-				const float invDepthV2{ 1.f / V2NDC.position.z };
+				for (int px{ blockMin.x }; px < blockMax.x; px += Width, edge0 = edge0 + groupStep0, edge1 = edge1 + groupStep1, edge2 = edge2 + groupStep2)
+				{
+					const int firstPixelIdx{ (py * SRInfo.screenSize.x) + px };
+					const int nrLanes{ std::min(Width, blockMax.x - px) };
+					const uint32_t laneMask{ FullMask >> (Width - nrLanes) };
+
+					//check which pixels are in triangle, all (biased) edge functions must be positive so none of them has the sign bit set
+					const uint32_t coverageMask{ isFullyCovered ? laneMask : (~SignMask(edge0 | edge1 | edge2) & laneMask) };
+					if (coverageMask == 0)
+						continue;
+
+					//calculate depth for current pixels from the depth plane, same operation order as AttributePlane::Evaluate
+					const FloatN planeX{ Set1(static_cast<float>(px - triangle.planeOrigin.x)) + LaneIndex() };
+					const FloatN pixelDepth{ depthOrigin + depthStepX * planeX + depthStepY * planeY };
+
+					//pixels past the end of the block may belong to another tile, so never load or store those directly
+					const bool isPartialGroup{ nrLanes < Width };
+					float* pDepth{ SRInfo.pDepthBufferPixels + firstPixelIdx };
+					if (isPartialGroup)
+					{
+						std::copy(pDepth, pDepth + nrLanes, partialDepths);
+						pDepth = partialDepths;
+					}
+
+					//handle depth test
+					const FloatN bufferDepth{ Load(pDepth) };
+					const uint32_t depthMask{ MoveMask(NotLess(bufferDepth, pixelDepth)) & coverageMask };
+					if (depthMask == 0)
+						continue;
+
+					//store depth weight in depth buffer
+					Store(pDepth, Select(MaskFromBits(depthMask), pixelDepth, bufferDepth));
+					if (isPartialGroup)
+					{
+						std::copy(partialDepths, partialDepths + nrLanes, SRInfo.pDepthBufferPixels + firstPixelIdx);
+					}
+					hasWrittenDepth = true;
 
-				const float pixelDepth
+					//visibility buffer only remembers which triangle is closest, shading happens once the whole tile is rasterized
+					if (SRInfo.isUsingVisibilityBuffer)
+					{
+						for (uint32_t survivorMask{ depthMask }; survivorMask != 0; survivorMask &= survivorMask - 1)
+						{
+							SRInfo.pTriangleIdBufferPixels[firstPixelIdx + std::countr_zero(survivorMask)] = triangleIdx;
+						}
+						continue;
+					}
+
+					//only shade the pixels that survived, all of them at once
+					stats.nrShadedPixels += std::popcount(depthMask);
+					ShadePixels<Config>(triangle, Int2{ px, py }, depthMask, pixelDepth, SRInfo);
+				}
+			}
+
+			return hasWrittenDepth;
+		} };
+
+		const int nrHiZBlocksX{ (SRInfo.screenSize.x + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE };
+
+		//walk the screen aligned blocks overlapping the bounding box, classifying each of them against the edge functions first
+		for (int blockY{ minY - minY % RASTER_BLOCK_SIZE }; blockY < maxY; blockY += RASTER_BLOCK_SIZE)
+		{
+			for (int blockX{ minX - minX % RASTER_BLOCK_SIZE }; blockX < maxX; blockX += RASTER_BLOCK_SIZE)
+			{
+				const Int2 blockMin{ std::max(blockX, minX), std::max(blockY, minY) };
+				const Int2 blockMax{ std::min(blockX + RASTER_BLOCK_SIZE, maxX), std::min(blockY + RASTER_BLOCK_SIZE, maxY) };
+
+				//edge functions are linear, so their extremes over the block are found at the corner pixels
+				int64_t blockEdges[3]{};
+				bool isOutside{ false };
+				bool isFullyCovered{ true };
+
+				for (int edgeIdx{}; edgeIdx < 3; ++edgeIdx)
 				{
-					1.f /
-					(
-						weightV0 * invDepthV0 +
-						weightV1 * invDepthV1 +
-						weightV2 * invDepthV2
-					)
-				};
+					blockEdges[edgeIdx] = triangle.edgeOrigin[edgeIdx] + triangle.edgeStepX[edgeIdx] * blockMin.x + triangle.edgeStepY[edgeIdx] * blockMin.y;
+
+					const int64_t spanX{ triangle.edgeStepX[edgeIdx] * (blockMax.x - blockMin.x - 1) };
+					const int64_t spanY{ triangle.edgeStepY[edgeIdx] * (blockMax.y - blockMin.y - 1) };
 
-				//handle depth test
-				if (SRInfo.pDepthBufferPixels[pixelIdx] < pixelDepth) continue;
+					const int64_t minEdge{ blockEdges[edgeIdx] + std::min<int64_t>(spanX, 0) + std::min<int64_t>(spanY, 0) };
+					const int64_t maxEdge{ blockEdges[edgeIdx] + std::max<int64_t>(spanX, 0) + std::max<int64_t>(spanY, 0) };
 
-				//store depth weight in depth buffer
-				SRInfo.pDepthBufferPixels[pixelIdx] = pixelDepth;
+					isOutside |= maxEdge < 0;
+					isFullyCovered &= minEdge >= 0;
+				}
 
-				//initialize final color
-				ColorRGB finalColor{};
+				//trivial reject
+				if (isOutside)
+					continue;
 
-				switch (SRInfo.SRState)
+				//everything in this block is closer than the triangle
+				const Int2 block{ blockX / RASTER_BLOCK_SIZE, blockY / RASTER_BLOCK_SIZE };
+				if (triangle.minDepth > SRInfo.pHiZBufferPixels[block.y * nrHiZBlocksX + block.x] + m_HiZTolerance)
 				{
-				case SoftwareRenderingState::DEPTH_BUFFER:
+					++stats.nrHiZRejectedBlocks;
+					continue;
+				}
+
+				if (rasterizeBlock(blockMin, blockMax, blockEdges, isFullyCovered))
 				{
-					//remap pixel depth to [0,1] range
-					const float remappedDepth = Remap(pixelDepth, .997f, 1.f);
+					UpdateHiZBlock(block, SRInfo);
+				}
+			}
+		}
+	}
+	template<typename Config>
+	void Mesh::ResolveVisibilityBuffer(const Int2& tileMin, const Int2& tileMax, SoftwareRenderingInfo& SRInfo, SoftwareRenderingStats& stats) const
+	{
+		using namespace SIMD;
 
-					finalColor = { remappedDepth, remappedDepth, remappedDepth };
+		uint32_t triangleIds[Width]{};
+		float pixelDepths[Width]{};
 
-					break;
-				}
+		for (int py{ tileMin.y }; py < tileMax.y; ++py)
+		{
+			for (int px{ tileMin.x }; px < tileMax.x; px += Width)
+			{
+				const int firstPixelIdx{ (py * SRInfo.screenSize.x) + px };
+				const int nrLanes{ std::min(Width, tileMax.x - px) };
 
-				case SoftwareRenderingState::DEFAULT:
+				//take the ids out of the buffer, so the next mesh starts from an empty visibility buffer again
+				uint32_t pendingMask{};
+				for (int lane{}; lane < nrLanes; ++lane)
 				{
-					//create combined vertex out with triangle info
-					VertexOut combinedTriangleInfo{};
+					triangleIds[lane] = SRInfo.pTriangleIdBufferPixels[firstPixelIdx + lane];
+					if (triangleIds[lane] == INVALID_TRIANGLE_ID)
+						continue;
 
-					//calculate interpolated depth for current triangle
-					const float invInterpolatedDepthV0{ 1.f / V0NDC.position.w };
-					const float invInterpolatedDepthV1{ 1.f / V1NDC.position.w };
-					const float invInterpolatedDepthV2{ 1.f / V2NDC.position.w };
+					SRInfo.pTriangleIdBufferPixels[firstPixelIdx + lane] = INVALID_TRIANGLE_ID;
+					pixelDepths[lane] = SRInfo.pDepthBufferPixels[firstPixelIdx + lane];
+					pendingMask |= 1u << lane;
+				}
 
-					//cache weight times depth for current triangle
-					const float weightTimesDepthV0{ weightV0 * invInterpolatedDepthV0 };
-					const float weightTimesDepthV1{ weightV1 * invInterpolatedDepthV1 };
-					const float weightTimesDepthV2{ weightV2 * invInterpolatedDepthV2 };
+				const FloatN pixelDepth{ Load(pixelDepths) };
 
-					const float interpolatedPixelDepth
-					{
-						1.f /
-						(
-							weightTimesDepthV0 +
-							weightTimesDepthV1 +
-							weightTimesDepthV2
-						)
-					};
-
-					//calculate pixel UV
-					const Vector2 pixelUV
-					{
-						(
-							weightTimesDepthV0 * V0NDC.uv +
-							weightTimesDepthV1 * V1NDC.uv +
-							weightTimesDepthV2 * V2NDC.uv
-						)
-						* interpolatedPixelDepth
-					};
-
-					//calculate pixel normal
-					Vector3 pixelNormal
-					{
-						(
-							weightTimesDepthV0 * V0NDC.normal +
-							weightTimesDepthV1 * V1NDC.normal +
-							weightTimesDepthV2 * V2NDC.normal
-						)
-						* interpolatedPixelDepth
-					};
-					pixelNormal.Normalize();
-
-					//calculate pixel tangent
-					Vector3 pixelTangent
-					{
-						(
-							weightTimesDepthV0 * V0NDC.tangent +
-							weightTimesDepthV1 * V1NDC.tangent +
-							weightTimesDepthV2 * V2NDC.tangent
-						)
-						* interpolatedPixelDepth
-					};
-					pixelTangent.Normalize();
-
-					//calculate pixel view direction
-					Vector3 pixelViewDirection
+				//neighbouring pixels mostly belong to the same triangle, shade every triangle in the group once for all of its lanes
+				while (pendingMask != 0)
+				{
+					const uint32_t triangleIdx{ triangleIds[std::countr_zero(pendingMask)] };
+
+					uint32_t triangleMask{};
+					for (uint32_t remainingMask{ pendingMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
 					{
-						(
-							weightTimesDepthV0 * V0NDC.viewDirection +
-							weightTimesDepthV1 * V1NDC.viewDirection +
-							weightTimesDepthV2 * V2NDC.viewDirection
-						)
-						* interpolatedPixelDepth
-					};
-					pixelViewDirection.Normalize();
-
-					//set combined triangle info
-					combinedTriangleInfo.uv = pixelUV;
-					combinedTriangleInfo.normal = pixelNormal;
-					combinedTriangleInfo.tangent = pixelTangent;
-					combinedTriangleInfo.viewDirection = pixelViewDirection;
-
-					PixelShading(combinedTriangleInfo, finalColor, SRInfo.shadingMode, SRInfo.isUsingNormalMap);
-
-					break;
-				}
-				
-				default:
-					break;
+						const int lane{ std::countr_zero(remainingMask) };
+						if (triangleIds[lane] == triangleIdx)
+						{
+							triangleMask |= 1u << lane;
+						}
+					}
+					pendingMask &= ~triangleMask;
+
+					//the plane equations of the stored triangle give the same attributes the forward path would have used
+					stats.nrShadedPixels += std::popcount(triangleMask);
+					ShadePixels<Config>(m_TriangleSetups[triangleIdx], Int2{ px, py }, triangleMask, pixelDepth, SRInfo);
 				}
+			}
+		}
+	}
+	template<typename Config>
+	void Mesh::ShadePixels(const TriangleSetup& triangle, const Int2& firstPixel, const uint32_t laneMask, const SIMD::FloatN& pixelDepth, SoftwareRenderingInfo& SRInfo) const
+	{
+		using namespace SIMD;
+
+		const int firstPixelIdx{ (firstPixel.y * SRInfo.screenSize.x) + firstPixel.x };
+
+		//initialize final color
+		ColorRGBN finalColor{};
+
+		if constexpr (Config::SRState == SoftwareRenderingState::DEPTH_BUFFER)
+		{
+			//remap pixel depth to [0,1] range
+			constexpr float minDepth{ .997f };
+			constexpr float maxDepth{ 1.f };
+			const FloatN remappedDepth{ (Min(Max(pixelDepth, Set1(minDepth)), Set1(maxDepth)) - Set1(minDepth)) / Set1(maxDepth - minDepth) };
+
+			finalColor = { remappedDepth, remappedDepth, remappedDepth };
+		}
+		else if constexpr (Config::isShading)
+		{
+			//pixel centers relative to the reference pixel of the plane equations
+			const FloatN x{ Set1(static_cast<float>(firstPixel.x - triangle.planeOrigin.x)) + LaneIndex() };
+			const FloatN y{ Set1(static_cast<float>(firstPixel.y - triangle.planeOrigin.y)) };
+
+			//calculate interpolated depth (w) for current pixels, undoes the division of the attributes
+			const FloatN interpolatedPixelDepth{ Set1(1.f) / triangle.invWPlane.Evaluate(x, y) };
+
+			//create combined vertices out with triangle info, attributes the shading mode doesn't read are left empty
+			VertexOutN combinedTriangleInfo{};
+
+			//calculate pixel UV
+			if constexpr (Config::isUsingUV)
+			{
+				combinedTriangleInfo.uv =
+				{
+					triangle.uvPlanes[0].Evaluate(x, y) * interpolatedPixelDepth,
+					triangle.uvPlanes[1].Evaluate(x, y) * interpolatedPixelDepth
+				};
+
+				//derivatives per 2x2 quad like the hardware does, from the uv at the quad's top left pixel & its neighbours to the right & below
+				const auto evaluateUV{ [&triangle](const FloatN& planeX, const FloatN& planeY)
+					{
+						const FloatN depth{ Set1(1.f) / triangle.invWPlane.Evaluate(planeX, planeY) };
+						return Vector2N{ triangle.uvPlanes[0].Evaluate(planeX, planeY) * depth, triangle.uvPlanes[1].Evaluate(planeX, planeY) * depth };
+					} };
+
+				const IntN pixelX{ Set1(firstPixel.x) + TruncateToInt(LaneIndex()) };
+				const FloatN quadX{ ToFloat(pixelX & Set1(~1)) - Set1(static_cast<float>(triangle.planeOrigin.x)) };
+				const FloatN quadY{ Set1(static_cast<float>((firstPixel.y & ~1) - triangle.planeOrigin.y)) };
+				const FloatN one{ Set1(1.f) };
+
+				const Vector2N quadUV{ evaluateUV(quadX, quadY) };
+				const Vector2N rightUV{ evaluateUV(quadX + one, quadY) };
+				const Vector2N belowUV{ evaluateUV(quadX, quadY + one) };
+				combinedTriangleInfo.uvDdx = { rightUV.x - quadUV.x, rightUV.y - quadUV.y };
+				combinedTriangleInfo.uvDdy = { belowUV.x - quadUV.x, belowUV.y - quadUV.y };
+			}
+
+			//calculate pixel normal
+			combinedTriangleInfo.normal = Normalized(
+			{
+				triangle.normalPlanes[0].Evaluate(x, y) * interpolatedPixelDepth,
+				triangle.normalPlanes[1].Evaluate(x, y) * interpolatedPixelDepth,
+				triangle.normalPlanes[2].Evaluate(x, y) * interpolatedPixelDepth
+			});
 
-				//Update Color in Buffer
-				finalColor.MaxToOne();
+			//calculate pixel tangent
+			if constexpr (Config::isUsingTangent)
+			{
+				combinedTriangleInfo.tangent = Normalized(
+				{
+					triangle.tangentPlanes[0].Evaluate(x, y) * interpolatedPixelDepth,
+					triangle.tangentPlanes[1].Evaluate(x, y) * interpolatedPixelDepth,
+					triangle.tangentPlanes[2].Evaluate(x, y) * interpolatedPixelDepth
+				});
+			}
 
-				SRInfo.pBackBufferPixels[pixelIdx] = SDL_MapRGB(SRInfo.pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
+			//calculate pixel view direction
+			if constexpr (Config::isUsingViewDirection)
+			{
+				combinedTriangleInfo.viewDirection = Normalized(
+				{
+					triangle.viewDirectionPlanes[0].Evaluate(x, y) * interpolatedPixelDepth,
+					triangle.viewDirectionPlanes[1].Evaluate(x, y) * interpolatedPixelDepth,
+					triangle.viewDirectionPlanes[2].Evaluate(x, y) * interpolatedPixelDepth
+				});
 			}
+
+			PixelShading<Config::shadingMode, Config::isUsingNormalMap>(combinedTriangleInfo, finalColor, laneMask);
+		}
+
+		//Update Color in Buffer, scale back the channels of colors that went over one
+		const FloatN maxValue{ Max(finalColor.r, Max(finalColor.g, finalColor.b)) };
+		const FloatN isOverOne{ Less(Set1(1.f), maxValue) };
+		finalColor =
+		{
+			Select(isOverOne, finalColor.r / maxValue, finalColor.r),
+			Select(isOverOne, finalColor.g / maxValue, finalColor.g),
+			Select(isOverOne, finalColor.b / maxValue, finalColor.b)
+		};
+
+		const FloatN channelScale{ Set1(255.f) };
+		int32_t reds[Width]{};
+		int32_t greens[Width]{};
+		int32_t blues[Width]{};
+		Store(reds, TruncateToInt(finalColor.r * channelScale));
+		Store(greens, TruncateToInt(finalColor.g * channelScale));
+		Store(blues, TruncateToInt(finalColor.b * channelScale));
+
+		for (uint32_t remainingMask{ laneMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
+		{
+			const int lane{ std::countr_zero(remainingMask) };
+
+			SRInfo.pBackBufferPixels[firstPixelIdx + lane] = SDL_MapRGB(SRInfo.pBackBuffer->format,
+				static_cast<uint8_t>(reds[lane]),
+				static_cast<uint8_t>(greens[lane]),
+				static_cast<uint8_t>(blues[lane]));
 		}
 	}
 
-	void Mesh::VertexTransformationFunction(const int width, const int height, const Matrix& viewMatrix, const Matrix& projMatrix, const Vector3& cameraPos)
+	void Mesh::VertexTransformationFunction(const int width, const int height, const Matrix& viewMatrix, const Matrix& projMatrix, const Vector3& cameraPos, ThreadPool* pThreadPool, const uint32_t nrThreads, const uint32_t chunkSize, const bool isTransformingLazily)
 	{
-		//clear out vertices vectors
-		m_VerticesOut.clear();
-		m_VerticesScreenSpace.clear();
-
-		//reserve space for vertices vectors
-		m_VerticesOut.reserve(m_Vertices.size());
-		m_VerticesScreenSpace.reserve(m_Vertices.size());
+		//drop the vertices clipping added last frame, every stream gets written by the transform below
+		const size_t nrVertices{ m_Vertices.size() };
+		m_VertexStreams.Resize(nrVertices);
+		m_VertexOutcodes.resize(nrVertices);
 
 		//Cache world matrix
 		const Matrix worldMatrix{ GetWorldMatrix() };
 		const Matrix worldViewProjMatrix{ worldMatrix * viewMatrix * projMatrix };
 
-		//transform each vertex using camera view matrix and perspective info
-		for (const Vertex& vertex : m_Vertices)
+		m_VertexTransform = VertexTransform{ worldMatrix, worldViewProjMatrix, cameraPos, width, height };
+		m_IsTransformingLazily = isTransformingLazily;
+
+		//cull whole meshlets first, so only the vertices of the ones left get transformed
+		m_ClipStats = {};
+		m_ClipStats.nrVertices = static_cast<uint32_t>(nrVertices);
+		CullMeshlets(worldMatrix, worldViewProjMatrix, cameraPos);
+
+		if (isTransformingLazily)
 		{
-			//Calculate view direction
-			Vector3 viewDirection{ worldMatrix.TransformPoint(vertex.position) -  cameraPos};
-			viewDirection.Normalize();
+			//start a new generation, the stamps only have to be reset when the generation would wrap around
+			if (m_PositionStamps.size() != nrVertices || m_TransformGeneration >= UINT32_MAX / 2)
+			{
+				m_PositionStamps.assign(nrVertices, 0);
+				m_AttributeStamps.assign(nrVertices, 0);
+				m_TransformGeneration = 0;
+			}
+			++m_TransformGeneration;
+		}
+		else
+		{
+			//transform each vertex to CLIP space using camera view matrix and perspective info, every chunk fills its own range of all streams in one go
+			const size_t verticesPerChunk{ std::max(chunkSize, 1u) };
+			const uint32_t nrChunks{ static_cast<uint32_t>((nrVertices + verticesPerChunk - 1) / verticesPerChunk) };
 
-			VertexOut temp{
-				Vector4{ worldViewProjMatrix.TransformPoint({ vertex.position, 1.f }) },
-				vertex.uv,
-				worldMatrix.TransformVector(vertex.normal).Normalized(),
-				worldMatrix.TransformVector(vertex.tangent).Normalized(),
-				viewDirection
-			};
+			pThreadPool->ParallelFor(nrChunks, [&](uint32_t chunkIdx)
+				{
+					const size_t firstIdx{ static_cast<size_t>(chunkIdx) * verticesPerChunk };
+					const size_t lastIdx{ std::min(firstIdx + verticesPerChunk, nrVertices) };
 
-			temp.position.x /= temp.position.w;
-			temp.position.y /= temp.position.w;
-			temp.position.z /= temp.position.w;
+					uint32_t nrTransformedVertices{};
+					for (size_t vertexIdx{ firstIdx }; vertexIdx < lastIdx; ++vertexIdx)
+					{
+						if (!m_IsVertexUsed[vertexIdx])
+							continue;
 
-			m_VerticesOut.emplace_back(temp);
+						TransformPosition(vertexIdx);
+						TransformAttributes(vertexIdx);
+						++nrTransformedVertices;
+					}
+
+					//outcodes for culling & clipping, computed while the chunk is still in cache
+					CalculateOutcodes(firstIdx, lastIdx);
+
+					std::atomic_ref{ m_ClipStats.nrTransformedPositions } += nrTransformedVertices;
+					std::atomic_ref{ m_ClipStats.nrTransformedAttributes } += nrTransformedVertices;
+				}, nrThreads);
 		}
 
-		//calculate vertices in SCREEN space
-		for (const VertexOut& vertice : m_VerticesOut)
+		//cull or clip triangles in CLIP space, lazily transformed vertices get their position the first time a triangle asks for it
+		const size_t nrTriangles{ GetNrTriangles() };
+		const uint32_t nrTriangleChunks{ static_cast<uint32_t>((nrTriangles + m_BinningChunkSize - 1) / m_BinningChunkSize) };
+
+		pThreadPool->ParallelFor(nrTriangleChunks, [&](uint32_t chunkIdx)
+			{
+				SoftwareRenderingStats chunkStats{};
+
+				const size_t firstTriangle{ static_cast<size_t>(chunkIdx) * m_BinningChunkSize };
+				const size_t lastTriangle{ std::min(firstTriangle + m_BinningChunkSize, nrTriangles) };
+
+				for (size_t triangleIdx{ firstTriangle }; triangleIdx < lastTriangle; ++triangleIdx)
+				{
+					//already culled with its meshlet, its vertices haven't been transformed
+					if (m_ClipResults[triangleIdx] == ClipResult::CULLED)
+						continue;
+
+					uint32_t V0Idx{}, V1Idx{}, V2Idx{};
+					GetTriangleIndices(triangleIdx, V0Idx, V1Idx, V2Idx);
+
+					if (isTransformingLazily)
+					{
+						chunkStats.nrTransformedPositions += RequestPosition(V0Idx) + RequestPosition(V1Idx) + RequestPosition(V2Idx);
+					}
+
+					const ClipResult clipResult{ ClassifyTriangle(m_VertexOutcodes[V0Idx], m_VertexOutcodes[V1Idx], m_VertexOutcodes[V2Idx]) };
+					m_ClipResults[triangleIdx] = clipResult;
+
+					switch (clipResult)
+					{
+					case ClipResult::ACCEPTED:
+						++chunkStats.nrAcceptedTriangles;
+						break;
+
+					case ClipResult::CULLED:
+						++chunkStats.nrCulledTriangles;
+						break;
+
+					case ClipResult::CLIPPED:
+						++chunkStats.nrClippedTriangles;
+						break;
+					}
+				}
+
+				std::atomic_ref{ m_ClipStats.nrAcceptedTriangles } += chunkStats.nrAcceptedTriangles;
+				std::atomic_ref{ m_ClipStats.nrClippedTriangles } += chunkStats.nrClippedTriangles;
+				std::atomic_ref{ m_ClipStats.nrCulledTriangles } += chunkStats.nrCulledTriangles;
+				std::atomic_ref{ m_ClipStats.nrTransformedPositions } += chunkStats.nrTransformedPositions;
+			}, nrThreads);
+
+		//clipping adds vertices, so the few triangles that need it are clipped on this thread in triangle order
+		m_ClippedIndices.clear();
+
+		for (size_t triangleIdx{}; triangleIdx < nrTriangles && m_ClipStats.nrClippedTriangles > 0; ++triangleIdx)
 		{
-			Vector2 temp{};
-			temp.x = ((vertice.position.x + 1) / 2) * static_cast<float>(width);
-			temp.y = ((1 - vertice.position.y) / 2) * static_cast<float>(height);
+			if (m_ClipResults[triangleIdx] != ClipResult::CLIPPED)
+				continue;
 
-			m_VerticesScreenSpace.emplace_back(temp);
+			uint32_t V0Idx{}, V1Idx{}, V2Idx{};
+			GetTriangleIndices(triangleIdx, V0Idx, V1Idx, V2Idx);
+
+			//the new vertices are interpolated from all attributes of the original ones
+			if (isTransformingLazily)
+			{
+				m_ClipStats.nrTransformedAttributes += RequestAttributes(V0Idx) + RequestAttributes(V1Idx) + RequestAttributes(V2Idx);
+			}
+
+			ClipTriangle(V0Idx, V1Idx, V2Idx);
+		}
+
+		//vertices created by clipping only get projected now
+		for (size_t vertexIdx{ nrVertices }; vertexIdx < m_VertexStreams.GetSize(); ++vertexIdx)
+		{
+			ProjectVertex(vertexIdx, width, height);
 		}
 	}
+	void Mesh::CullMeshlets(const Matrix& worldMatrix, const Matrix& worldViewProjMatrix, const Vector3& cameraPos)
+	{
+		//Frustum planes in object space straight from the columns of the world view projection matrix (Gribb & Hartmann)
+		const Vector4 columns[4]
+		{
+			{ worldViewProjMatrix[0].x, worldViewProjMatrix[1].x, worldViewProjMatrix[2].x, worldViewProjMatrix[3].x },
+			{ worldViewProjMatrix[0].y, worldViewProjMatrix[1].y, worldViewProjMatrix[2].y, worldViewProjMatrix[3].y },
+			{ worldViewProjMatrix[0].z, worldViewProjMatrix[1].z, worldViewProjMatrix[2].z, worldViewProjMatrix[3].z },
+			{ worldViewProjMatrix[0].w, worldViewProjMatrix[1].w, worldViewProjMatrix[2].w, worldViewProjMatrix[3].w }
+		};
+
+		Vector4 frustumPlanes[6]
+		{
+			columns[2],					//near, z >= 0
+			columns[3] - columns[2],	//far
+			columns[3] + columns[0],	//left
+			columns[3] - columns[0],	//right
+			columns[3] + columns[1],	//bottom
+			columns[3] - columns[1]		//top
+		};
+		for (Vector4& plane : frustumPlanes)
+		{
+			plane = plane * (1.f / plane.GetXYZ().Magnitude());
+		}
+
+		//the cone only knows which side of the triangles is the back, it can't cull front faces
+		//a mirroring world matrix flips the winding, the cone is skipped then as well
+		const bool isConeCulling
+		{
+			m_CullMode == CullMode::BACK &&
+			Vector3::Dot(Vector3::Cross(worldMatrix.GetAxisX(), worldMatrix.GetAxisY()), worldMatrix.GetAxisZ()) > 0.f
+		};
+		const Vector3 objectCameraPos{ Matrix::Inverse(worldMatrix).TransformPoint(cameraPos) };
+
+		const size_t nrTriangles{ GetNrTriangles() };
+		m_ClipResults.assign(nrTriangles, ClipResult::ACCEPTED);
+		m_IsVertexUsed.assign(m_Vertices.size(), m_Meshlets.empty() ? 1 : 0);
 
-	bool Mesh::IsVerticeInFrustum(const VertexOut& vertice)
+		m_ClipStats.nrMeshlets = static_cast<uint32_t>(m_Meshlets.size());
+
+		for (const Meshlet& meshlet : m_Meshlets)
+		{
+			if (MeshletBuilder::IsOutsideFrustum(meshlet, frustumPlanes) || (isConeCulling && MeshletBuilder::IsBackFacing(meshlet, objectCameraPos)))
+			{
+				std::fill_n(m_ClipResults.begin() + meshlet.firstTriangle, meshlet.nrTriangles, ClipResult::CULLED);
+
+				++m_ClipStats.nrCulledMeshlets;
+				m_ClipStats.nrMeshletCulledTriangles += meshlet.nrTriangles;
+				continue;
+			}
+
+			for (uint32_t i{}; i < meshlet.nrVertices; ++i)
+			{
+				m_IsVertexUsed[m_MeshletVertices[meshlet.firstVertex + i]] = 1;
+			}
+		}
+	}
+	void Mesh::TransformPosition(const size_t vertexIdx)
 	{
-		const Vector4 verticePos{ vertice.position };
+		const Vertex& vertex{ m_Vertices[vertexIdx] };
 
-		//check x-pos
-		if (verticePos.x < -1.f || verticePos.x > 1.f)
-			return false;
+		m_VertexStreams.clipPositions[vertexIdx] = Vector4{ m_VertexTransform.worldViewProjMatrix.TransformPoint({ vertex.position, 1.f }) };
+		ProjectVertex(vertexIdx, m_VertexTransform.width, m_VertexTransform.height);
+	}
+	void Mesh::TransformAttributes(const size_t vertexIdx)
+	{
+		const Vertex& vertex{ m_Vertices[vertexIdx] };
+		const Matrix& worldMatrix{ m_VertexTransform.worldMatrix };
 
-		//check y-pos
-		if (verticePos.y < -1.f || verticePos.y > 1.f)
+		//Calculate view direction
+		Vector3 viewDirection{ worldMatrix.TransformPoint(vertex.position) - m_VertexTransform.cameraPos };
+		viewDirection.Normalize();
+
+		m_VertexStreams.uvs[vertexIdx] = vertex.uv;
+		m_VertexStreams.normals[vertexIdx] = worldMatrix.TransformVector(vertex.normal).Normalized();
+		m_VertexStreams.tangents[vertexIdx] = worldMatrix.TransformVector(vertex.tangent).Normalized();
+		m_VertexStreams.viewDirections[vertexIdx] = viewDirection;
+	}
+	template<typename TransformFunction>
+	bool Mesh::TransformOnce(std::vector<uint32_t>& stamps, const uint32_t vertexIdx, const TransformFunction& transform)
+	{
+		//vertices created by clipping are complete from the start
+		if (vertexIdx >= stamps.size())
 			return false;
 
-		//check z-pos
-		if (verticePos.z < 0.f || verticePos.z > 1.f)
+		std::atomic_ref<uint32_t> stamp{ stamps[vertexIdx] };
+		const uint32_t busyStamp{ m_TransformGeneration * 2 };
+		const uint32_t doneStamp{ busyStamp + 1 };
+
+		uint32_t currentStamp{ stamp.load(std::memory_order_acquire) };
+		if (currentStamp == doneStamp)
 			return false;
 
-		//if all values are valid, return true
-		return true;
+		//the thread that swaps in the busy stamp does the work, so every vertex is transformed exactly once per frame
+		if (currentStamp != busyStamp && stamp.compare_exchange_strong(currentStamp, busyStamp, std::memory_order_acquire))
+		{
+			transform(vertexIdx);
+			stamp.store(doneStamp, std::memory_order_release);
+			return true;
+		}
+
+		//another thread got there first, transforming a single vertex is quick so just wait for it
+		while (stamp.load(std::memory_order_acquire) != doneStamp)
+		{
+			std::this_thread::yield();
+		}
+		return false;
 	}
-	bool Mesh::IsCrossCheckValid(const float edge1Cross, const float edge2Cross, const float edge3Cross) const
+	bool Mesh::RequestPosition(const uint32_t vertexIdx)
 	{
-		switch (m_CullMode)
+		return TransformOnce(m_PositionStamps, vertexIdx, [this](const size_t idx)
+			{
+				TransformPosition(idx);
+				m_VertexOutcodes[idx] = CalculateOutcode(m_VertexStreams.clipPositions[idx]);
+			});
+	}
+	bool Mesh::RequestAttributes(const uint32_t vertexIdx)
+	{
+		return TransformOnce(m_AttributeStamps, vertexIdx, [this](const size_t idx) { TransformAttributes(idx); });
+	}
+	void Mesh::ProjectVertex(const size_t vertexIdx, const int width, const int height)
+	{
+		const Vector4& clipPosition{ m_VertexStreams.clipPositions[vertexIdx] };
+
+		//perspective divide, the clip position itself is kept for clipping
+		const float ndcX{ clipPosition.x / clipPosition.w };
+		const float ndcY{ clipPosition.y / clipPosition.w };
+
+		m_VertexStreams.depths[vertexIdx] = clipPosition.z / clipPosition.w;
+		m_VertexStreams.invWs[vertexIdx] = 1.f / clipPosition.w;
+
+		//calculate vertex in SCREEN space
+		m_VertexStreams.screenPositions[vertexIdx] =
+		{
+			((ndcX + 1) / 2) * static_cast<float>(width),
+			((1 - ndcY) / 2) * static_cast<float>(height)
+		};
+	}
+
+	void Mesh::CalculateOutcodes(const size_t firstIdx, const size_t lastIdx)
+	{
+		using namespace SIMD;
+
+		const FloatN zero{ Set1(0.f) };
+		const FloatN guardBand{ Set1(m_GuardBand) };
+
+		//handle Width vertices at once, the positions are gathered into lanes first
+		for (size_t groupIdx{ firstIdx }; groupIdx < lastIdx; groupIdx += Width)
 		{
-		case CullMode::BACK:
+			const int nrLanes{ static_cast<int>(std::min<size_t>(Width, lastIdx - groupIdx)) };
+
+			float xs[Width]{};
+			float ys[Width]{};
+			float zs[Width]{};
+			float ws[Width]{};
+			for (int lane{}; lane < nrLanes; ++lane)
+			{
+				const Vector4& position{ m_VertexStreams.clipPositions[groupIdx + lane] };
+				xs[lane] = position.x;
+				ys[lane] = position.y;
+				zs[lane] = position.z;
+				ws[lane] = position.w;
+			}
+
+			const FloatN x{ Load(xs) };
+			const FloatN y{ Load(ys) };
+			const FloatN z{ Load(zs) };
+			const FloatN w{ Load(ws) };
+
+			const FloatN negW{ zero - w };
+			const FloatN guardBandW{ guardBand * w };
+			const FloatN negGuardBandW{ zero - guardBandW };
+
+			//one lane mask per outcode bit, in bit order
+			const uint32_t planeMasks[8]
+			{
+				MoveMask(Less(z, zero)),
+				MoveMask(Less(w, z)),
+				MoveMask(Less(x, negW)),
+				MoveMask(Less(w, x)),
+				MoveMask(Less(y, negW)),
+				MoveMask(Less(w, y)),
+				MoveMask(Less(x, negGuardBandW)) | MoveMask(Less(guardBandW, x)),
+				MoveMask(Less(y, negGuardBandW)) | MoveMask(Less(guardBandW, y))
+			};
+
+			for (int lane{}; lane < nrLanes; ++lane)
+			{
+				uint8_t outcode{};
+				for (int bit{}; bit < 8; ++bit)
+				{
+					outcode |= static_cast<uint8_t>(((planeMasks[bit] >> lane) & 1) << bit);
+				}
+				m_VertexOutcodes[groupIdx + lane] = outcode;
+			}
+		}
+	}
+	uint8_t Mesh::CalculateOutcode(const Vector4& clipPosition)
+	{
+		//same tests as CalculateOutcodes, for a single vertex
+		const float guardBandW{ m_GuardBand * clipPosition.w };
+
+		uint8_t outcode{};
+		if (clipPosition.z < 0.f) outcode |= m_OutcodeNear;
+		if (clipPosition.w < clipPosition.z) outcode |= m_OutcodeFar;
+		if (clipPosition.x < -clipPosition.w) outcode |= m_OutcodeLeft;
+		if (clipPosition.w < clipPosition.x) outcode |= m_OutcodeRight;
+		if (clipPosition.y < -clipPosition.w) outcode |= m_OutcodeBottom;
+		if (clipPosition.w < clipPosition.y) outcode |= m_OutcodeTop;
+		if (clipPosition.x < -guardBandW || guardBandW < clipPosition.x) outcode |= m_OutcodeGuardBandX;
+		if (clipPosition.y < -guardBandW || guardBandW < clipPosition.y) outcode |= m_OutcodeGuardBandY;
+
+		return outcode;
+	}
+	ClipResult Mesh::ClassifyTriangle(const uint8_t V0Outcode, const uint8_t V1Outcode, const uint8_t V2Outcode)
+	{
+		//all vertices outside the same frustum plane
+		if ((V0Outcode & V1Outcode & V2Outcode & m_OutcodeFrustumMask) != 0)
+			return ClipResult::CULLED;
+
+		//crossing the near plane or leaving the guard band, the rest is handled by the clamped bounding box
+		if (((V0Outcode | V1Outcode | V2Outcode) & m_OutcodeClipMask) != 0)
+			return ClipResult::CLIPPED;
+
+		return ClipResult::ACCEPTED;
+	}
+	void Mesh::ClipTriangle(const uint32_t V0Idx, const uint32_t V1Idx, const uint32_t V2Idx)
+	{
+		//every plane can add one vertex to the polygon
+		constexpr int nrPlanes{ 5 };
+		constexpr int maxNrVertices{ 3 + nrPlanes };
+
+		//signed distance to the near plane & the guard band planes, positive is inside
+		const auto getDistance{ [](const int planeIdx, const Vector4& pos)
+		{
+			switch (planeIdx)
+			{
+			case 0: return pos.z;
+			case 1: return m_GuardBand * pos.w + pos.x;
+			case 2: return m_GuardBand * pos.w - pos.x;
+			case 3: return m_GuardBand * pos.w + pos.y;
+			default: return m_GuardBand * pos.w - pos.y;
+			}
+		} };
+
+		VertexOut polygon[maxNrVertices]{ GetVertexOut(V0Idx), GetVertexOut(V1Idx), GetVertexOut(V2Idx) };
+		VertexOut clippedPolygon[maxNrVertices]{};
+		int nrVertices{ 3 };
+
+		for (int planeIdx{}; planeIdx < nrPlanes && nrVertices >= 3; ++planeIdx)
+		{
+			float distances[maxNrVertices]{};
+			bool isCrossingPlane{ false };
+			for (int vertexIdx{}; vertexIdx < nrVertices; ++vertexIdx)
+			{
+				distances[vertexIdx] = getDistance(planeIdx, polygon[vertexIdx].position);
+				isCrossingPlane |= distances[vertexIdx] < 0.f;
+			}
+
+			//only split against the planes that actually cut the triangle
+			if (!isCrossingPlane)
+				continue;
+
+			//Sutherland-Hodgman, keep inside vertices & add a vertex where an edge crosses the plane
+			int nrClippedVertices{};
+			for (int vertexIdx{}; vertexIdx < nrVertices; ++vertexIdx)
+			{
+				const int nextIdx{ (vertexIdx + 1) % nrVertices };
+
+				const bool isInside{ distances[vertexIdx] >= 0.f };
+				const bool isNextInside{ distances[nextIdx] >= 0.f };
+
+				if (isInside)
+				{
+					clippedPolygon[nrClippedVertices++] = polygon[vertexIdx];
+				}
+				if (isInside != isNextInside)
+				{
+					const float factor{ distances[vertexIdx] / (distances[vertexIdx] - distances[nextIdx]) };
+					clippedPolygon[nrClippedVertices++] = LerpVertex(polygon[vertexIdx], polygon[nextIdx], factor);
+				}
+			}
+
+			std::copy(clippedPolygon, clippedPolygon + nrClippedVertices, polygon);
+			nrVertices = nrClippedVertices;
+		}
+
+		//nothing left after clipping
+		if (nrVertices < 3)
+			return;
+
+		//add the polygon as a fan, the winding of the original triangle is kept
+		const uint32_t firstIdx{ static_cast<uint32_t>(m_VertexStreams.GetSize()) };
+		m_VertexStreams.Resize(firstIdx + nrVertices);
+
+		for (int vertexIdx{}; vertexIdx < nrVertices; ++vertexIdx)
 		{
-			//Check if all results are positive
-			return (edge1Cross > 0.f && edge2Cross > 0.f && edge3Cross > 0.f);
+			m_VertexStreams.clipPositions[firstIdx + vertexIdx] = polygon[vertexIdx].position;
+			m_VertexStreams.uvs[firstIdx + vertexIdx] = polygon[vertexIdx].uv;
+			m_VertexStreams.normals[firstIdx + vertexIdx] = polygon[vertexIdx].normal;
+			m_VertexStreams.tangents[firstIdx + vertexIdx] = polygon[vertexIdx].tangent;
+			m_VertexStreams.viewDirections[firstIdx + vertexIdx] = polygon[vertexIdx].viewDirection;
 		}
 
-		case CullMode::FRONT:
+		for (int vertexIdx{ 1 }; vertexIdx < nrVertices - 1; ++vertexIdx)
 		{
-			//Check if all results are negative
-			return (edge1Cross < 0.f && edge2Cross < 0.f && edge3Cross < 0.f);
+			m_ClippedIndices.push_back(firstIdx);
+			m_ClippedIndices.push_back(firstIdx + vertexIdx);
+			m_ClippedIndices.push_back(firstIdx + vertexIdx + 1);
 		}
+	}
+	VertexOut Mesh::GetVertexOut(const uint32_t vertexIdx) const
+	{
+		return VertexOut{
+			m_VertexStreams.clipPositions[vertexIdx],
+			m_VertexStreams.uvs[vertexIdx],
+			m_VertexStreams.normals[vertexIdx],
+			m_VertexStreams.tangents[vertexIdx],
+			m_VertexStreams.viewDirections[vertexIdx]
+		};
+	}
+	VertexOut Mesh::LerpVertex(const VertexOut& V0, const VertexOut& V1, const float factor)
+	{
+		return VertexOut{
+			V0.position + (V1.position - V0.position) * factor,
+			V0.uv + (V1.uv - V0.uv) * factor,
+			V0.normal + (V1.normal - V0.normal) * factor,
+			V0.tangent + (V1.tangent - V0.tangent) * factor,
+			V0.viewDirection + (V1.viewDirection - V0.viewDirection) * factor
+		};
+	}
+
+	bool Mesh::IsOccludedByHiZ(const TriangleSetup& triangle, const Int2& regionMin, const Int2& regionMax, const SoftwareRenderingInfo& SRInfo)
+	{
+		const int nrHiZBlocksX{ (SRInfo.screenSize.x + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE };
+
+		//blocks overlapping the part of the bounding box inside the region
+		const int minBlockX{ std::max(triangle.minBoundingBox.x, regionMin.x) / RASTER_BLOCK_SIZE };
+		const int minBlockY{ std::max(triangle.minBoundingBox.y, regionMin.y) / RASTER_BLOCK_SIZE };
+		const int maxBlockX{ (std::min(triangle.maxBoundingBox.x, regionMax.x) - 1) / RASTER_BLOCK_SIZE };
+		const int maxBlockY{ (std::min(triangle.maxBoundingBox.y, regionMax.y) - 1) / RASTER_BLOCK_SIZE };
 
-		case CullMode::NONE:
+		for (int blockY{ minBlockY }; blockY <= maxBlockY; ++blockY)
 		{
-			//Check if all results are positive or all results are negative
-			return (edge1Cross > 0.f && edge2Cross > 0.f && edge3Cross > 0.f) || (edge1Cross < 0.f && edge2Cross < 0.f && edge3Cross < 0.f);
+			for (int blockX{ minBlockX }; blockX <= maxBlockX; ++blockX)
+			{
+				if (triangle.minDepth <= SRInfo.pHiZBufferPixels[blockY * nrHiZBlocksX + blockX] + m_HiZTolerance)
+					return false;
+			}
 		}
+
+		return true;
+	}
+	void Mesh::UpdateHiZBlock(const Int2& block, const SoftwareRenderingInfo& SRInfo)
+	{
+		const int nrHiZBlocksX{ (SRInfo.screenSize.x + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE };
+
+		//depth only ever decreases, so the new max has to be searched again over the whole block
+		const int minX{ block.x * RASTER_BLOCK_SIZE };
+		const int minY{ block.y * RASTER_BLOCK_SIZE };
+		const int maxX{ std::min(minX + RASTER_BLOCK_SIZE, SRInfo.screenSize.x) };
+		const int maxY{ std::min(minY + RASTER_BLOCK_SIZE, SRInfo.screenSize.y) };
+
+		float maxDepth{};
+		for (int py{ minY }; py < maxY; ++py)
+		{
+			const float* pRow{ SRInfo.pDepthBufferPixels + (py * SRInfo.screenSize.x) };
+			maxDepth = std::max(maxDepth, *std::max_element(pRow + minX, pRow + maxX));
 		}
 
-		return false;
+		SRInfo.pHiZBufferPixels[block.y * nrHiZBlocksX + block.x] = maxDepth;
+	}
+	Int64_2 Mesh::ToFixedPoint(const Vector2& screenPos)
+	{
+		return Int64_2{ std::llround(screenPos.x * m_SubPixelScale), std::llround(screenPos.y * m_SubPixelScale) };
 	}
 
-	void Mesh::PixelShading(const VertexOut& vertice, ColorRGB& finalColor, const ShadingMode shadingMode, const bool isUsingNormalMap) const
+	template<ShadingMode shadingMode, bool isUsingNormalMap>
+	void Mesh::PixelShading(const VertexOutN& vertices, SIMD::ColorRGBN& finalColor, const uint32_t laneMask) const
 	{
+		using namespace SIMD;
+
 		//shading info
-		const Vector3 lightDirection{ .577f, -.577f, .577f };
-		constexpr float lightIntensity{ 7.f };
+		const Vector3N lightDirection{ Set1(.577f), Set1(-.577f), Set1(.577f) };
 
-		constexpr float kd{ 1.f };
-		constexpr float shininess{ 25.f };
-		constexpr ColorRGB ambientColor{ .025f, .025f, .025f };
+		//one fetch for every map, kd / PI * light intensity & the shininess are already applied
+		//until every map is set there's no material, that shades like black maps with a flat normal
+		MaterialN material{};
+		material.normal = Vector3N{ Set1(0.f), Set1(0.f), Set1(1.f) };
+		if constexpr (isUsingNormalMap || shadingMode != ShadingMode::OBSERVED_AREA)
+		{
+			if (m_pMaterialTexture)
+				material = m_pMaterialTexture->SampleMaterial(m_Sampler, vertices.uv, vertices.uvDdx, vertices.uvDdy, laneMask);
+		}
 
 		//calculate sampled normal
-		Vector3 sampledNormal{ vertice.normal };
+		Vector3N sampledNormal{ vertices.normal };
 
 		//handle showing normal map
-		if (isUsingNormalMap)
+		if constexpr (isUsingNormalMap)
 		{
-			const Vector3 binormal{ Vector3::Cross(vertice.normal, vertice.tangent) };
-			const Matrix tangentSpaceAxis{ vertice.tangent, binormal.Normalized(), vertice.normal, { 0.f, 0.f ,0.f } };
+			const Vector3N binormal{ Normalized(Cross(vertices.normal, vertices.tangent)) };
 
-			const ColorRGB normalColor{ m_pNormalTexture->Sample(vertice.uv) };
-			sampledNormal = { normalColor.r, normalColor.g, normalColor.b };
+			const Vector3N& tangentSpaceNormal{ material.normal };
 
-			sampledNormal = 2 * sampledNormal - Vector3{ 1.f, 1.f, 1.f };
-			sampledNormal = tangentSpaceAxis.TransformVector(sampledNormal);
+			//transform from tangent space, rows are tangent, binormal & normal
+			sampledNormal =
+			{
+				vertices.tangent.x * tangentSpaceNormal.x + binormal.x * tangentSpaceNormal.y + vertices.normal.x * tangentSpaceNormal.z,
+				vertices.tangent.y * tangentSpaceNormal.x + binormal.y * tangentSpaceNormal.y + vertices.normal.y * tangentSpaceNormal.z,
+				vertices.tangent.z * tangentSpaceNormal.x + binormal.z * tangentSpaceNormal.y + vertices.normal.z * tangentSpaceNormal.z
+			};
 		}
-		sampledNormal.Normalize();
+		sampledNormal = Normalized(sampledNormal);
 
 		//calculate observed area
-		const float observedArea{ Saturate(Vector3::Dot(sampledNormal, -lightDirection)) };
+		const Vector3N inverseLightDirection{ Set1(-.577f), Set1(.577f), Set1(-.577f) };
+		const FloatN observedArea{ Saturate(Dot(sampledNormal, inverseLightDirection)) };
 
 		//handle the different shading modes
-		switch (shadingMode)
+		if constexpr (shadingMode == ShadingMode::OBSERVED_AREA)
 		{
-		case ShadingMode::OBSERVED_AREA:
-			finalColor += { observedArea, observedArea, observedArea };
-			break;
-
-		case ShadingMode::DIFFUSE:
-			finalColor += (m_pDiffuseTexture->Sample(vertice.uv) * kd / PI) * lightIntensity * observedArea;
-			break;
-
-		case ShadingMode::SPECULAR:
-			finalColor += CalculateSpecularColor(sampledNormal, lightDirection, vertice, shininess) * observedArea;
-			break;
-
-		case ShadingMode::COMBINED:
-			const ColorRGB diffuseColor{ (m_pDiffuseTexture->Sample(vertice.uv) * kd / PI) * lightIntensity };
-			const ColorRGB specularColor{ CalculateSpecularColor(sampledNormal, lightDirection, vertice, shininess) };
+			finalColor = finalColor + ColorRGBN{ observedArea, observedArea, observedArea };
+		}
+		else if constexpr (shadingMode == ShadingMode::DIFFUSE)
+		{
+			finalColor = finalColor + material.diffuse * observedArea;
+		}
+		else if constexpr (shadingMode == ShadingMode::SPECULAR)
+		{
+			finalColor = finalColor + CalculateSpecularColor(sampledNormal, lightDirection, vertices, material) * observedArea;
+		}
+		else if constexpr (shadingMode == ShadingMode::COMBINED)
+		{
+			const ColorRGBN specularColor{ CalculateSpecularColor(sampledNormal, lightDirection, vertices, material) };
 
-			finalColor += (diffuseColor * observedArea) + specularColor;
-			break;
+			finalColor = finalColor + ((material.diffuse * observedArea) + specularColor);
 		}
 
-		finalColor += ambientColor;
+		finalColor = finalColor + ColorRGBN{ Set1(m_AmbientColor), Set1(m_AmbientColor), Set1(m_AmbientColor) };
 	}
 
-	ColorRGB Mesh::CalculateSpecularColor(const Vector3& sampledNormal, const Vector3& lightDirection, const VertexOut& vertice, const float shininess) const
+	SIMD::ColorRGBN Mesh::CalculateSpecularColor(const SIMD::Vector3N& sampledNormal, const SIMD::Vector3N& lightDirection, const VertexOutN& vertices, const MaterialN& material) const
 	{
-		const Vector3 reflectVector{ Vector3::Reflect(lightDirection, sampledNormal) };
-		const float reflectAngle{ Saturate(Vector3::Dot(reflectVector, -vertice.viewDirection)) };
+		using namespace SIMD;
 
-		const ColorRGB glossinessColor{ m_pGlossinessTexture->Sample(vertice.uv) };
-		const float glossinessExponent{ glossinessColor.r * shininess };
+		//reflect the light direction around the normal
+		const FloatN reflectScale{ Set1(2.f) * Dot(lightDirection, sampledNormal) };
+		const Vector3N reflectVector
+		{
+			lightDirection.x - sampledNormal.x * reflectScale,
+			lightDirection.y - sampledNormal.y * reflectScale,
+			lightDirection.z - sampledNormal.z * reflectScale
+		};
+
+		const Vector3N inverseViewDirection{ -vertices.viewDirection.x, -vertices.viewDirection.y, -vertices.viewDirection.z };
+		const FloatN reflectAngle{ Saturate(Dot(reflectVector, inverseViewDirection)) };
 
-		const float phongValue{ powf(reflectAngle, glossinessExponent) };
+		const FloatN phongValue{ Pow(reflectAngle, material.glossiness) };
 
-		return m_pSpecularTexture->Sample(vertice.uv) * phongValue;
+		return material.specular * phongValue;
 	}
 #pragma endregion
 
@@ -600,6 +1561,10 @@ namespace dae
 	{
 		m_pEffect->SetSampler(pSampler);
 	}
+	void Mesh::SetSampler(const SoftwareSampler& sampler)
+	{
+		m_Sampler = sampler;
+	}
 	void Mesh::SetRasterizerState(ID3D11RasterizerState* pRasterizerState, const CullMode cullMode)
 	{
 		m_CullMode = cullMode;
@@ -631,6 +1596,7 @@ namespace dae
 		//Make sure the previous texture is deleted
 		delete m_pDiffuseTexture;
 		m_pDiffuseTexture = pDiffuseTexture;
+		BakeMaterial();
 
 		m_pEffect->SetDiffuseMap(pDiffuseTexture);
 	}
@@ -639,6 +1605,7 @@ namespace dae
 		//Make sure the previous texture is deleted
 		delete m_pNormalTexture;
 		m_pNormalTexture = pNormalTexture;
+		BakeMaterial();
 
 		const EffectStandard* pTempEffect{ dynamic_cast<EffectStandard*>(m_pEffect) };
 
@@ -650,6 +1617,7 @@ namespace dae
 		//Make sure the previous texture is deleted
 		delete m_pSpecularTexture;
 		m_pSpecularTexture = pSpecularTexture;
+		BakeMaterial();
 
 		const EffectStandard* pTempEffect{ dynamic_cast<EffectStandard*>(m_pEffect) };
 
@@ -661,11 +1629,24 @@ namespace dae
 		//Make sure the previous texture is deleted
 		delete m_pGlossinessTexture;
 		m_pGlossinessTexture = pGlossinessTexture;
+		BakeMaterial();
 
 		const EffectStandard* pTempEffect{ dynamic_cast<EffectStandard*>(m_pEffect) };
 
 		if (pTempEffect != nullptr)
 			pTempEffect->SetGlossinessMap(pGlossinessTexture);
 	}
+	void Mesh::BakeMaterial()
+	{
+		//Make sure the previous material is deleted, a new one is baked once every map is there
+		delete m_pMaterialTexture;
+		m_pMaterialTexture = nullptr;
+
+		if (!m_pDiffuseTexture || !m_pNormalTexture || !m_pSpecularTexture || !m_pGlossinessTexture)
+			return;
+
+		const MaterialFactors factors{ m_Kd / PI * m_LightIntensity, m_Shininess };
+		m_pMaterialTexture = Texture::BakeMaterial(m_pDiffuseTexture, m_pNormalTexture, m_pSpecularTexture, m_pGlossinessTexture, factors);
+	}
 #pragma endregion
 }
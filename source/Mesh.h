@@ -4,11 +4,15 @@ namespace dae
 {
 	class Texture;
 	class Effect;
+	class MeshData;
+	struct Meshlet;
+	struct MeshLod;
+	struct MaterialN;
 
 	class Mesh final
 	{
 	public:
-		Mesh(ID3D11Device* pDevice, const EffectType effectType, const std::wstring& effectFilename, const std::vector<Vertex>&& vertices, const std::vector<uint32_t>&& indices);
+		Mesh(ID3D11Device* pDevice, const EffectType effectType, const std::wstring& effectFilename, MeshData* pMeshData);
 		~Mesh();
 
 		Mesh(const Mesh&) = delete;
@@ -17,7 +21,7 @@ namespace dae
 		Mesh& operator=(Mesh&&) noexcept = delete;
 
 		void RenderDirectX(ID3D11DeviceContext* pDeviceContext) const;
-		void RenderSoftware(SoftwareRenderingInfo& SRInfo) const;
+		void RenderSoftware(SoftwareRenderingInfo& SRInfo);
 
 		void InitializeTransform(const Vector3& translation = Vector3::Zero, const Vector3& rotation = Vector3::Zero, const Vector3& scale = Vector3::One);
 		void SetTranslation(const Vector3& translation);
@@ -27,10 +31,12 @@ namespace dae
 		void RotateY(const float angle);
 
 		void SetSampler(ID3D11SamplerState* pSampler) const;
+		void SetSampler(const SoftwareSampler& sampler);
 		void SetRasterizerState(ID3D11RasterizerState* pRasterizerState, const CullMode cullMode);
 
 		void UpdateMatrices(const Matrix& viewMatrix, const Matrix& projMatrix, const Matrix& viewInverseMatrix) const;
-		void VertexTransformationFunction(const int width, const int height, const Matrix& viewMatrix, const Matrix& projMatrix, const Vector3& cameraPos);
+		void UpdateLod(const Matrix& viewMatrix, const Matrix& projMatrix, const int screenHeight);
+		void VertexTransformationFunction(const int width, const int height, const Matrix& viewMatrix, const Matrix& projMatrix, const Vector3& cameraPos, ThreadPool* pThreadPool, const uint32_t nrThreads, const uint32_t chunkSize, const bool isTransformingLazily);
 		
 		void SetDiffuseMap(Texture* pDiffuseTexture);
 		void SetNormalMap(Texture* pNormalTexture);
@@ -41,6 +47,14 @@ namespace dae
 		{
 			return m_PrimitiveTopology;
 		}
+		uint32_t GetLodIdx() const
+		{
+			return m_LodIdx;
+		}
+		uint32_t GetNrLods() const
+		{
+			return std::max(static_cast<uint32_t>(m_Lods.size()), 1u);
+		}
 
 	private:
 		Matrix m_TranslationMatrix{ Matrix::CreateTranslation(Vector3::Zero) };
@@ -55,6 +69,16 @@ namespace dae
 
 		Matrix GetWorldMatrix() const;
 
+		//Levels of detail, both paths draw the index range of the current level out of the same buffers
+		//a level is picked when its error stays under m_LodPixelError on screen, a coarser one only once it stays under m_LodHysteresis of that so it doesn't flicker
+		static constexpr float m_LodPixelError{ 1.f };
+		static constexpr float m_LodHysteresis{ 0.75f };
+
+		std::span<const MeshLod> m_Lods{};
+		uint32_t m_LodIdx{};
+
+		void SetLod(const uint32_t lodIdx);
+
 		//DirectX
 		EffectType m_EffectType{};
 		Effect* m_pEffect{};
@@ -64,29 +88,138 @@ namespace dae
 		ID3D11InputLayout* m_pInputLayout{};
 		ID3D11Buffer* m_pIndexBuffer{};
 
+		uint32_t m_StartIndex{};
 		uint32_t m_NumIndices{};
 
 		HRESULT CreateLayouts(ID3D11Device* pDevice);
 		HRESULT CreateBuffers(ID3D11Device* pDevice);
 
 		//Software
-		std::vector<Vertex> m_Vertices{};
-		std::vector<uint32_t> m_Indices{};
+		MeshData* m_pMeshData{}; //owned, the spans below may point straight into its mapped cache file
+		std::span<const Vertex> m_Vertices{};
+		std::span<const uint32_t> m_Indices{}; //of the current level of detail
 		
-		std::vector<Vector2> m_VerticesScreenSpace{};
-		std::vector<VertexOut> m_VerticesOut{};
+		VertexStreams m_VertexStreams{}; //transformed vertices followed by the ones created by clipping
+
+		//Software - vertex transform of the current frame, kept around so vertices can still be transformed while binning
+		struct VertexTransform
+		{
+			Matrix worldMatrix{};
+			Matrix worldViewProjMatrix{};
+			Vector3 cameraPos{};
+			int width{};
+			int height{};
+		};
+		VertexTransform m_VertexTransform{};
+
+		//Software - lazy vertex transform, a vertex only gets transformed the first time a triangle that survived culling needs it
+		//every vertex is stamped with the generation it was transformed in, generation * 2 while a thread is busy with it & generation * 2 + 1 once it's done
+		//starting a new generation makes all stamps of the previous frame stale without touching them
+		bool m_IsTransformingLazily{};
+		uint32_t m_TransformGeneration{};
+		std::vector<uint32_t> m_PositionStamps{}; //parallel to m_Vertices, clip & screen position, depth & outcode
+		std::vector<uint32_t> m_AttributeStamps{}; //parallel to m_Vertices, everything that only gets interpolated when shading
+
+		void TransformPosition(const size_t vertexIdx);
+		void TransformAttributes(const size_t vertexIdx);
+		bool RequestPosition(const uint32_t vertexIdx);
+		bool RequestAttributes(const uint32_t vertexIdx);
+		template<typename TransformFunction>
+		bool TransformOnce(std::vector<uint32_t>& stamps, const uint32_t vertexIdx, const TransformFunction& transform);
+
+		//Software - clipping
+		static constexpr float m_GuardBand{ 8.f }; //x & y may reach m_GuardBand * w in clip space before a triangle has to be clipped
+
+		//packed per vertex outcode bits, the first six are the frustum planes
+		static constexpr uint8_t m_OutcodeNear{ 1 << 0 };
+		static constexpr uint8_t m_OutcodeFar{ 1 << 1 };
+		static constexpr uint8_t m_OutcodeLeft{ 1 << 2 };
+		static constexpr uint8_t m_OutcodeRight{ 1 << 3 };
+		static constexpr uint8_t m_OutcodeBottom{ 1 << 4 };
+		static constexpr uint8_t m_OutcodeTop{ 1 << 5 };
+		static constexpr uint8_t m_OutcodeGuardBandX{ 1 << 6 };
+		static constexpr uint8_t m_OutcodeGuardBandY{ 1 << 7 };
+
+		static constexpr uint8_t m_OutcodeFrustumMask{ 0x3F };
+		static constexpr uint8_t m_OutcodeClipMask{ m_OutcodeNear | m_OutcodeGuardBandX | m_OutcodeGuardBandY };
+
+		//Software - meshlets, culled as a whole before any of their vertices get transformed
+		//meshes without meshlets (not optimized at load) have all of their vertices transformed
+		std::span<const Meshlet> m_Meshlets{};
+		std::span<const uint32_t> m_MeshletVertices{};
+		std::vector<uint8_t> m_IsVertexUsed{}; //parallel to m_Vertices, only vertices of meshlets that survived culling get transformed
+
+		void CullMeshlets(const Matrix& worldMatrix, const Matrix& worldViewProjMatrix, const Vector3& cameraPos);
+
+		std::vector<uint8_t> m_VertexOutcodes{}; //parallel to m_Vertices
+		std::vector<ClipResult> m_ClipResults{};
+		std::vector<uint32_t> m_ClippedIndices{}; //triangle list made of the pieces of the clipped triangles
+		SoftwareRenderingStats m_ClipStats{};
 
 		Texture* m_pDiffuseTexture{};
 		Texture* m_pNormalTexture{};
 		Texture* m_pSpecularTexture{};
 		Texture* m_pGlossinessTexture{};
+		Texture* m_pMaterialTexture{}; //the four maps above baked into one, the only texture software shading samples (nullptr until all four are set)
+		SoftwareSampler m_Sampler{};
+
+		void BakeMaterial();
 
 		CullMode m_CullMode{};
 
-		void RenderTriangle(const size_t idx, SoftwareRenderingInfo& SRInfo, const bool shouldSwapVertices = false) const;
-		static bool IsVerticeInFrustum(const VertexOut& vertice);
-		bool IsCrossCheckValid(const float edge1Cross, const float edge2Cross, const float edge3Cross) const;
-		void PixelShading(const VertexOut& vertice, ColorRGB& finalColor, const ShadingMode shadingMode, const bool isUsingNormalMap) const;
-		ColorRGB CalculateSpecularColor(const Vector3& sampledNormal, const Vector3& lightDirection, const VertexOut& vertice, const float shininess) const;
+		//Software - rasterization
+		static constexpr int m_SubPixelBits{ 8 };
+		static constexpr int64_t m_SubPixelScale{ 1 << m_SubPixelBits };
+		static constexpr float m_HiZTolerance{ 1e-5f }; //covers the rounding of the per pixel depth, so HiZ never rejects a pixel that would pass the depth test
+
+		//Software - binning
+		const uint32_t m_BinningChunkSize{ 1024 };
+
+		std::vector<TriangleSetup> m_TriangleSetups{};
+		std::vector<std::vector<uint32_t>> m_TileBins{}; //[chunkIdx * nrTiles + tileIdx] => triangle indices in submission order
+
+		size_t GetNrTriangles() const;
+		void GetTriangleIndices(const size_t triangleIdx, uint32_t& V0Idx, uint32_t& V1Idx, uint32_t& V2Idx) const;
+		void ProjectVertex(const size_t vertexIdx, const int width, const int height);
+		void CalculateOutcodes(const size_t firstIdx, const size_t lastIdx);
+		static uint8_t CalculateOutcode(const Vector4& clipPosition);
+		static ClipResult ClassifyTriangle(const uint8_t V0Outcode, const uint8_t V1Outcode, const uint8_t V2Outcode);
+		void ClipTriangle(const uint32_t V0Idx, const uint32_t V1Idx, const uint32_t V2Idx);
+		VertexOut GetVertexOut(const uint32_t vertexIdx) const;
+		static VertexOut LerpVertex(const VertexOut& V0, const VertexOut& V1, const float factor);
+
+		//Software - kernels, specialized per RasterKernelConfig and picked once per draw
+		using RenderKernel = void (Mesh::*)(SoftwareRenderingInfo&);
+
+		static constexpr int m_NrCullModes{ 3 };
+		static constexpr int m_NrSRStates{ 3 };
+		static constexpr int m_NrShadingModes{ 4 };
+		static constexpr int m_NrRenderKernels{ m_NrCullModes * m_NrSRStates * m_NrShadingModes * 2 };
+
+		template<size_t kernelIdx>
+		static constexpr RenderKernel GetRenderKernel();
+
+		template<typename Config>
+		void RenderSoftwareKernel(SoftwareRenderingInfo& SRInfo);
+		template<typename Config>
+		bool SetupTriangle(const uint32_t V0Idx, const uint32_t V1Idx, const uint32_t V2Idx, const SoftwareRenderingInfo& SRInfo, TriangleSetup& triangle, SoftwareRenderingStats& stats);
+		template<typename Config>
+		void RenderTriangle(const uint32_t triangleIdx, const Int2& tileMin, const Int2& tileMax, SoftwareRenderingInfo& SRInfo, SoftwareRenderingStats& stats) const;
+		template<typename Config>
+		void ResolveVisibilityBuffer(const Int2& tileMin, const Int2& tileMax, SoftwareRenderingInfo& SRInfo, SoftwareRenderingStats& stats) const;
+		template<typename Config>
+		void ShadePixels(const TriangleSetup& triangle, const Int2& firstPixel, const uint32_t laneMask, const SIMD::FloatN& pixelDepth, SoftwareRenderingInfo& SRInfo) const;
+		static bool IsOccludedByHiZ(const TriangleSetup& triangle, const Int2& regionMin, const Int2& regionMax, const SoftwareRenderingInfo& SRInfo);
+		static void UpdateHiZBlock(const Int2& block, const SoftwareRenderingInfo& SRInfo);
+		static Int64_2 ToFixedPoint(const Vector2& screenPos);
+		template<ShadingMode shadingMode, bool isUsingNormalMap>
+		void PixelShading(const VertexOutN& vertices, SIMD::ColorRGBN& finalColor, const uint32_t laneMask) const;
+		SIMD::ColorRGBN CalculateSpecularColor(const SIMD::Vector3N& sampledNormal, const SIMD::Vector3N& lightDirection, const VertexOutN& vertices, const MaterialN& material) const;
+
+		//Software - shading constants, the ones that scale a map are baked into m_pMaterialTexture
+		static constexpr float m_LightIntensity{ 7.f };
+		static constexpr float m_Kd{ 1.f };
+		static constexpr float m_Shininess{ 25.f };
+		static constexpr float m_AmbientColor{ .025f };
 	};
 }
@@ -0,0 +1,955 @@
+#include "pch.h"
+#include "MeshData.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "MeshSimplifier.h"
+#include <bit>
+#include <filesystem>
+#include <fstream>
+
+namespace dae
+{
+	//Binary mesh cache: header, welded vertices, indices, meshlets, meshlet vertices & levels of detail; every array starts on an alignment boundary so they can be used in place
+	struct MeshCacheHeader
+	{
+		static constexpr uint32_t magic{ 0x4D455348 }; //"MESH"
+		static constexpr uint32_t version{ 7 }; //7: meshlets only split on their budget or on a triangle facing away from the cone
+		static constexpr uint32_t flipAxisAndWindingFlag{ 1 << 0 };
+		static constexpr uint32_t optimizedFlag{ 1 << 1 };
+		static constexpr uint32_t streamedFlag{ 1 << 2 }; //built out of core, those are never optimized
+		static constexpr uint64_t alignment{ 64 };
+
+		uint32_t fileMagic{ magic };
+		uint32_t fileVersion{ version };
+		uint32_t vertexSize{ sizeof(Vertex) };
+		uint32_t flags{};
+		uint32_t meshletSize{ sizeof(Meshlet) };
+		uint32_t lodSize{ sizeof(MeshLod) };
+
+		//what the cache was built from, a cache is reused when size & write time match or, failing that, the content hash does
+		uint64_t sourceSize{};
+		int64_t sourceWriteTime{};
+		uint64_t sourceHash{};
+
+		uint64_t nrVertices{};
+		uint64_t nrIndices{};
+		uint64_t verticesOffset{};
+		uint64_t indicesOffset{};
+
+		//only optimized caches have meshlets & levels of detail, the indices & meshlets of all levels follow each other
+		uint64_t nrMeshlets{};
+		uint64_t nrMeshletVertices{};
+		uint64_t nrLods{};
+		uint64_t meshletsOffset{};
+		uint64_t meshletVerticesOffset{};
+		uint64_t lodsOffset{};
+
+		MeshBounds bounds{};
+
+		//only set with the optimized flag, a cache optimized with other settings is outdated
+		MeshOptimizationSettings optimizationSettings{};
+		MeshOptimizationStats optimizationStats{};
+	};
+	static_assert(std::is_trivially_copyable_v<MeshCacheHeader> && std::is_trivially_copyable_v<Vertex> && std::is_trivially_copyable_v<Meshlet> && std::is_trivially_copyable_v<MeshLod>);
+
+	static uint64_t AlignCacheOffset(uint64_t offset)
+	{
+		return (offset + MeshCacheHeader::alignment - 1) & ~(MeshCacheHeader::alignment - 1);
+	}
+
+	static void RunJobs(ThreadPool* pThreadPool, uint32_t nrJobs, const std::function<void(uint32_t)>& job)
+	{
+		if (pThreadPool)
+		{
+			pThreadPool->ParallelFor(nrJobs, job);
+			return;
+		}
+
+		for (uint32_t jobIdx{}; jobIdx < nrJobs; ++jobIdx)
+		{
+			job(jobIdx);
+		}
+	}
+
+	//Fast non cryptographic hash, four independent lanes of 8 bytes so it runs at memory speed
+	static uint64_t HashBytes(const char* pData, size_t size, uint64_t seed)
+	{
+		constexpr uint64_t prime0{ 0x9E3779B185EBCA87ull };
+		constexpr uint64_t prime1{ 0xC2B2AE3D27D4EB4Full };
+
+		uint64_t lanes[4]{ seed + prime0 + prime1, seed + prime1, seed, seed - prime0 };
+
+		size_t offset{};
+		for (; offset + 32 <= size; offset += 32)
+		{
+			for (int laneIdx{}; laneIdx < 4; ++laneIdx)
+			{
+				uint64_t word{};
+				memcpy(&word, pData + offset + laneIdx * 8, sizeof(word));
+				lanes[laneIdx] = std::rotl(lanes[laneIdx] + word * prime1, 31) * prime0;
+			}
+		}
+
+		uint64_t hash{ std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18) + size };
+		for (; offset < size; ++offset)
+		{
+			hash = std::rotl(hash ^ (static_cast<uint8_t>(pData[offset]) * prime0), 11) * prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime1;
+		hash ^= hash >> 29;
+		return hash;
+	}
+
+	//Hashes the file in fixed size chunks on the thread pool, then hashes the chunk hashes in order so the result doesn't depend on the number of threads
+	static uint64_t HashFileContent(const MappedFile& file, ThreadPool* pThreadPool)
+	{
+		constexpr size_t chunkSize{ 4 << 20 };
+		const uint32_t nrChunks{ static_cast<uint32_t>((file.GetSize() + chunkSize - 1) / chunkSize) };
+
+		std::vector<uint64_t> chunkHashes(nrChunks);
+		RunJobs(pThreadPool, nrChunks, [&](uint32_t chunkIdx)
+			{
+				const size_t chunkBegin{ chunkIdx * chunkSize };
+				chunkHashes[chunkIdx] = HashBytes(file.GetData() + chunkBegin, std::min(chunkSize, file.GetSize() - chunkBegin), chunkIdx);
+			});
+
+		return HashBytes(reinterpret_cast<const char*>(chunkHashes.data()), chunkHashes.size() * sizeof(uint64_t), file.GetSize());
+	}
+
+	static bool IsCacheHeaderValid(const MeshCacheHeader& header, size_t cacheSize, const MeshCacheHeader& sourceHeader)
+	{
+		if (header.fileMagic != MeshCacheHeader::magic || header.fileVersion != MeshCacheHeader::version || header.vertexSize != sizeof(Vertex) || header.meshletSize != sizeof(Meshlet) || header.lodSize != sizeof(MeshLod))
+			return false;
+
+		constexpr uint32_t flipFlag{ MeshCacheHeader::flipAxisAndWindingFlag };
+		constexpr uint32_t optimizedFlag{ MeshCacheHeader::optimizedFlag };
+		if ((header.flags & flipFlag) != (sourceHeader.flags & flipFlag))
+			return false;
+
+		//a streamed cache is used whether optimizing was asked for or not, it would only be streamed again
+		if (!(header.flags & MeshCacheHeader::streamedFlag))
+		{
+			if ((header.flags & optimizedFlag) != (sourceHeader.flags & optimizedFlag))
+				return false;
+
+			const MeshOptimizationSettings& settings{ header.optimizationSettings };
+			const MeshOptimizationSettings& sourceSettings{ sourceHeader.optimizationSettings };
+			if ((header.flags & optimizedFlag)
+				&& (settings.cacheSize != sourceSettings.cacheSize || settings.overdrawThreshold != sourceSettings.overdrawThreshold
+					|| settings.maxNrLods != sourceSettings.maxNrLods || settings.lodReduction != sourceSettings.lodReduction))
+				return false;
+		}
+
+		//the arrays have to be aligned & lie completely inside of the file
+		const auto isArrayInside{ [cacheSize](uint64_t offset, uint64_t nrElements, size_t elementSize)
+			{
+				return offset % MeshCacheHeader::alignment == 0 && nrElements <= cacheSize / elementSize && offset <= cacheSize - nrElements * elementSize;
+			} };
+
+		return isArrayInside(header.verticesOffset, header.nrVertices, sizeof(Vertex))
+			&& isArrayInside(header.indicesOffset, header.nrIndices, sizeof(uint32_t))
+			&& isArrayInside(header.meshletsOffset, header.nrMeshlets, sizeof(Meshlet))
+			&& isArrayInside(header.meshletVerticesOffset, header.nrMeshletVertices, sizeof(uint32_t))
+			&& isArrayInside(header.lodsOffset, header.nrLods, sizeof(MeshLod));
+	}
+
+	static bool IsCacheLodInside(const MeshLod& lod, uint64_t nrIndices, uint64_t nrMeshlets)
+	{
+		return lod.nrIndices % 3 == 0 && uint64_t{ lod.firstIndex } + lod.nrIndices <= nrIndices && uint64_t{ lod.firstMeshlet } + lod.nrMeshlets <= nrMeshlets;
+	}
+
+	//Every level has to lie inside of the index & meshlet lists, a mapped cache is used without copying so this is checked once up front
+	static bool AreCacheLodsValid(std::span<const MeshLod> lods, uint64_t nrIndices, uint64_t nrMeshlets)
+	{
+		return std::ranges::all_of(lods, [=](const MeshLod& lod) { return IsCacheLodInside(lod, nrIndices, nrMeshlets); });
+	}
+
+	//Every index & meshlet has to point inside of the lists it's used on, checked once up front for the same reason as the levels
+	//a meshlet's triangles count from its level's first index, meshlets of levels that are out of range themselves are left to AreCacheLodsValid
+	static bool IsCacheContentValid(const MeshCacheHeader& header, const char* pData)
+	{
+		const std::span<const uint32_t> indices{ reinterpret_cast<const uint32_t*>(pData + header.indicesOffset), static_cast<size_t>(header.nrIndices) };
+		const std::span<const Meshlet> meshlets{ reinterpret_cast<const Meshlet*>(pData + header.meshletsOffset), static_cast<size_t>(header.nrMeshlets) };
+		const std::span<const uint32_t> meshletVertices{ reinterpret_cast<const uint32_t*>(pData + header.meshletVerticesOffset), static_cast<size_t>(header.nrMeshletVertices) };
+		const std::span<const MeshLod> lods{ reinterpret_cast<const MeshLod*>(pData + header.lodsOffset), static_cast<size_t>(header.nrLods) };
+
+		const auto isVertex{ [nrVertices = header.nrVertices](uint32_t vertexIdx) { return vertexIdx < nrVertices; } };
+		if (header.nrIndices % 3 != 0 || !std::ranges::all_of(indices, isVertex) || !std::ranges::all_of(meshletVertices, isVertex))
+			return false;
+
+		const auto areMeshletsInside{ [&](std::span<const Meshlet> levelMeshlets, uint64_t nrTriangles)
+			{
+				return std::ranges::all_of(levelMeshlets, [&](const Meshlet& meshlet)
+					{
+						return uint64_t{ meshlet.firstTriangle } + meshlet.nrTriangles <= nrTriangles && uint64_t{ meshlet.firstVertex } + meshlet.nrVertices <= header.nrMeshletVertices;
+					});
+			} };
+
+		//without levels every meshlet is used on the whole index list
+		if (!areMeshletsInside(meshlets, header.nrIndices / 3))
+			return false;
+
+		for (const MeshLod& lod : lods)
+		{
+			if (IsCacheLodInside(lod, header.nrIndices, header.nrMeshlets) && !areMeshletsInside(meshlets.subspan(lod.firstMeshlet, lod.nrMeshlets), lod.nrIndices / 3))
+				return false;
+		}
+		return true;
+	}
+
+	//Only the header changes, the arrays are left where they are
+	static bool RewriteCacheHeader(const std::string& cachePath, const MeshCacheHeader& header)
+	{
+		std::fstream file{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+		if (!file)
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		return static_cast<bool>(file);
+	}
+
+	static bool WriteMeshCache(const std::string& cachePath, const MeshCacheHeader& header, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+		std::span<const Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const MeshLod> lods)
+	{
+		//write next to the cache & swap it in at the end, so an interrupted write never leaves a half written cache behind
+		const std::string tempPath{ cachePath + ".tmp" };
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file)
+				return false;
+
+			const char padding[MeshCacheHeader::alignment]{};
+			uint64_t fileSize{};
+
+			//pads up to the array's offset first, the arrays are written in the order of their offsets
+			const auto writeArray{ [&](uint64_t offset, const void* pData, size_t size)
+				{
+					file.write(padding, static_cast<std::streamsize>(offset - fileSize));
+					file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(size));
+					fileSize = offset + size;
+				} };
+
+			writeArray(0, &header, sizeof(header));
+			writeArray(header.verticesOffset, vertices.data(), vertices.size_bytes());
+			writeArray(header.indicesOffset, indices.data(), indices.size_bytes());
+			writeArray(header.meshletsOffset, meshlets.data(), meshlets.size_bytes());
+			writeArray(header.meshletVerticesOffset, meshletVertices.data(), meshletVertices.size_bytes());
+			writeArray(header.lodsOffset, lods.data(), lods.size_bytes());
+
+			if (!file)
+				return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		return true;
+	}
+
+	//Temporary file next to the cache, removed again when it goes out of scope
+	struct SpillFile
+	{
+		explicit SpillFile(const std::string& spillPath)
+			: path{ spillPath }
+			, stream{ spillPath, std::ios::binary | std::ios::trunc }
+		{
+		}
+		~SpillFile()
+		{
+			stream.close();
+
+			std::error_code error{};
+			std::filesystem::remove(path, error);
+		}
+
+		SpillFile(const SpillFile&) = delete;
+		SpillFile(SpillFile&&) noexcept = delete;
+		SpillFile& operator=(const SpillFile&) = delete;
+		SpillFile& operator=(SpillFile&&) noexcept = delete;
+
+		template<typename T>
+		void Write(const T* pElements, size_t nrElements)
+		{
+			stream.write(reinterpret_cast<const char*>(pElements), static_cast<std::streamsize>(nrElements * sizeof(T)));
+		}
+
+		//has to be closed before it can be mapped to be read back
+		bool Close()
+		{
+			const bool isWritten{ !stream.fail() };
+			stream.close();
+			return isWritten && !stream.fail();
+		}
+
+		std::string path;
+		std::ofstream stream;
+	};
+
+	//Builds the cache for filename without ever holding the whole mesh in memory:
+	//1. the OBJ is parsed a window of lines at a time, the pools & resolved face corners are spilled to disk
+	//2. the corners are welded a range of positions at a time, the vertices & indices are spilled again
+	//3. tangents are accumulated a range of vertices at a time, those vertices are then finished & written into the cache
+	//Every pass reads the spill files of the pass before it mapped, so only the per pass arrays count against the budget
+	static bool BuildMeshCacheOutOfCore(const std::string& filename, const std::string& cachePath, MeshCacheHeader header, const MeshStreamingSettings& settings, ThreadPool* pThreadPool, MeshLoadStats* pStats)
+	{
+		using Utils::OBJChunk;
+		using Utils::OBJVertexKey;
+
+		const MappedFile sourceFile{ filename };
+		if (!sourceFile.IsValid())
+			return false;
+
+		constexpr size_t minMemoryBudget{ 16 << 20 };
+		const size_t memoryBudget{ std::max(settings.memoryBudget, minMemoryBudget) };
+		const bool flipAxisAndWinding{ (header.flags & MeshCacheHeader::flipAxisAndWindingFlag) != 0 };
+		header.flags = (header.flags & ~MeshCacheHeader::optimizedFlag) | MeshCacheHeader::streamedFlag;
+		header.optimizationSettings = {};
+
+		size_t peakBytes{};
+		const auto reportProgress{ [&settings](MeshStreamingStage stage, size_t nrDone, size_t nrTotal)
+			{
+				if (settings.progressCallback)
+				{
+					settings.progressCallback(stage, (nrTotal > 0) ? static_cast<float>(static_cast<double>(nrDone) / static_cast<double>(nrTotal)) : 1.f);
+				}
+			} };
+
+		const auto parseStart{ std::chrono::high_resolution_clock::now() };
+
+		//1. Parse, the chunks of a window are parsed in parallel & then resolved & spilled in file order
+		SpillFile positionsFile{ cachePath + ".positions.tmp" };
+		SpillFile UVsFile{ cachePath + ".uvs.tmp" };
+		SpillFile normalsFile{ cachePath + ".normals.tmp" };
+		SpillFile cornersFile{ cachePath + ".corners.tmp" };
+
+		size_t nrPositions{};
+		size_t nrUVs{};
+		size_t nrNormals{};
+		size_t nrCorners{};
+		{
+			//parsed lines take up to about twice the size of their text
+			const size_t windowSize{ memoryBudget / 4 };
+			const uint32_t nrChunks{ pThreadPool ? pThreadPool->GetNrThreads() : 1 };
+			std::vector<OBJChunk> chunks(nrChunks);
+
+			const char* pFileBegin{ sourceFile.GetData() };
+			const char* pFileEnd{ pFileBegin + sourceFile.GetSize() };
+			for (const char* pWindow{ pFileBegin }; pWindow < pFileEnd;)
+			{
+				const char* pWindowEnd{ Utils::FindOBJLineStart(pWindow + std::min(windowSize, static_cast<size_t>(pFileEnd - pWindow)), pFileEnd) };
+
+				const std::vector<const char*> chunkBegins{ Utils::SplitOBJLines(pWindow, pWindowEnd, nrChunks) };
+				RunJobs(pThreadPool, nrChunks, [&](uint32_t chunkIdx)
+					{
+						Utils::ParseOBJChunk(chunkBegins[chunkIdx], chunkBegins[chunkIdx + 1], chunks[chunkIdx], flipAxisAndWinding);
+					});
+
+				size_t windowBytes{};
+				for (OBJChunk& chunk : chunks)
+				{
+					if (!chunk.isValid)
+						return false;
+
+					//relative indices are resolved against everything spilled before this chunk
+					for (OBJVertexKey& key : chunk.faceCorners)
+					{
+						key = Utils::ResolveOBJVertexKey(key, nrPositions, nrUVs, nrNormals);
+					}
+
+					positionsFile.Write(chunk.positions.data(), chunk.positions.size());
+					UVsFile.Write(chunk.UVs.data(), chunk.UVs.size());
+					normalsFile.Write(chunk.normals.data(), chunk.normals.size());
+					cornersFile.Write(chunk.faceCorners.data(), chunk.faceCorners.size());
+
+					nrPositions += chunk.positions.size();
+					nrUVs += chunk.UVs.size();
+					nrNormals += chunk.normals.size();
+					nrCorners += chunk.faceCorners.size();
+
+					windowBytes += chunk.positions.capacity() * sizeof(Vector3) + chunk.UVs.capacity() * sizeof(Vector2)
+						+ chunk.normals.capacity() * sizeof(Vector3) + chunk.faceCorners.capacity() * sizeof(OBJVertexKey);
+					chunk = {};
+				}
+				peakBytes = std::max(peakBytes, windowBytes);
+
+				pWindow = pWindowEnd;
+				reportProgress(MeshStreamingStage::PARSING, static_cast<size_t>(pWindow - pFileBegin), sourceFile.GetSize());
+			}
+		}
+
+		if (!positionsFile.Close() || !UVsFile.Close() || !normalsFile.Close() || !cornersFile.Close())
+			return false;
+
+		const auto weldStart{ std::chrono::high_resolution_clock::now() };
+
+		//2. Weld, every pass only welds the corners of its range of positions & scatters their indices to the corner's slot
+		SpillFile verticesFile{ cachePath + ".vertices.tmp" };
+		SpillFile indicesFile{ cachePath + ".indices.tmp" };
+
+		size_t nrVertices{};
+		size_t nrWeldPasses{};
+		bool hasMissingNormals{ false };
+		{
+			const MappedFile positionsMap{ positionsFile.path };
+			const MappedFile UVsMap{ UVsFile.path };
+			const MappedFile normalsMap{ normalsFile.path };
+			const MappedFile cornersMap{ cornersFile.path };
+
+			const Vector3* pPositions{ reinterpret_cast<const Vector3*>(positionsMap.GetData()) };
+			const Vector2* pUVs{ reinterpret_cast<const Vector2*>(UVsMap.GetData()) };
+			const Vector3* pNormals{ reinterpret_cast<const Vector3*>(normalsMap.GetData()) };
+			const OBJVertexKey* pCorners{ reinterpret_cast<const OBJVertexKey*>(cornersMap.GetData()) };
+
+			//a chain head per position of the range, and the key & next link of the vertices made from it (about 2 per position)
+			constexpr size_t bytesPerPosition{ sizeof(uint32_t) + 2 * (sizeof(OBJVertexKey) + sizeof(uint32_t)) };
+			const size_t bufferSize{ memoryBudget / 8 }; //for the vertex & the index write buffer each
+			const size_t positionsPerPass{ std::max<size_t>((memoryBudget - 2 * bufferSize) / bytesPerPosition, 1) };
+			nrWeldPasses = std::max<size_t>((nrPositions + positionsPerPass - 1) / positionsPerPass, 1);
+
+			constexpr uint32_t endOfChain{ UINT32_MAX };
+			std::vector<uint32_t> firstVertexOfPosition{};
+			std::vector<uint32_t> nextVertexOfPosition{};
+			std::vector<OBJVertexKey> vertexKeys{};
+			std::vector<Vertex> vertexBuffer{};
+
+			//indices of consecutive corners, written as one run
+			std::vector<uint32_t> indexBuffer{};
+			size_t indexBufferFirstCorner{};
+			const auto flushIndices{ [&]()
+				{
+					if (indexBuffer.empty())
+						return;
+
+					indicesFile.stream.seekp(static_cast<std::streamoff>(indexBufferFirstCorner * sizeof(uint32_t)));
+					indicesFile.Write(indexBuffer.data(), indexBuffer.size());
+					indexBuffer.clear();
+				} };
+
+			for (size_t passIdx{}; passIdx < nrWeldPasses; ++passIdx)
+			{
+				const size_t firstPosition{ passIdx * positionsPerPass };
+				const size_t lastPosition{ std::min(nrPositions, firstPosition + positionsPerPass) };
+				const size_t firstVertex{ nrVertices };
+
+				firstVertexOfPosition.assign(lastPosition - firstPosition, endOfChain);
+				nextVertexOfPosition.clear();
+				vertexKeys.clear();
+
+				for (size_t cornerIdx{}; cornerIdx < nrCorners; ++cornerIdx)
+				{
+					if ((cornerIdx & 0xFFFFF) == 0)
+					{
+						reportProgress(MeshStreamingStage::WELDING, passIdx * nrCorners + cornerIdx, nrWeldPasses * nrCorners);
+					}
+
+					const OBJVertexKey key{ pCorners[cornerIdx] };
+
+					//indices pointing outside of the pools
+					if (key.iPosition - 1 >= nrPositions || key.iTexCoord > nrUVs || key.iNormal > nrNormals)
+						return false;
+
+					const size_t positionIdx{ key.iPosition - 1 };
+					if (positionIdx < firstPosition || positionIdx >= lastPosition)
+					{
+						flushIndices();
+						continue;
+					}
+
+					uint32_t& chainHead{ firstVertexOfPosition[positionIdx - firstPosition] };
+					uint32_t vertexIdx{ chainHead };
+					while (vertexIdx != endOfChain && !(vertexKeys[vertexIdx] == key))
+					{
+						vertexIdx = nextVertexOfPosition[vertexIdx];
+					}
+
+					if (vertexIdx == endOfChain)
+					{
+						vertexIdx = static_cast<uint32_t>(vertexKeys.size());
+						nextVertexOfPosition.push_back(chainHead);
+						chainHead = vertexIdx;
+						vertexKeys.push_back(key);
+
+						Vertex vertex{};
+						vertex.position = pPositions[positionIdx];
+						if (key.iTexCoord != 0) vertex.uv = pUVs[key.iTexCoord - 1];
+						if (key.iNormal != 0) vertex.normal = pNormals[key.iNormal - 1];
+						hasMissingNormals = hasMissingNormals || Utils::IsMissingNormal(vertex);
+
+						vertexBuffer.push_back(vertex);
+						if (vertexBuffer.size() * sizeof(Vertex) >= bufferSize)
+						{
+							verticesFile.Write(vertexBuffer.data(), vertexBuffer.size());
+							vertexBuffer.clear();
+						}
+					}
+
+					if (indexBuffer.size() * sizeof(uint32_t) >= bufferSize)
+					{
+						flushIndices();
+					}
+					if (indexBuffer.empty())
+					{
+						indexBufferFirstCorner = cornerIdx;
+					}
+					indexBuffer.push_back(static_cast<uint32_t>(firstVertex + vertexIdx));
+				}
+
+				flushIndices();
+				verticesFile.Write(vertexBuffer.data(), vertexBuffer.size());
+				vertexBuffer.clear();
+
+				nrVertices += vertexKeys.size();
+				if (nrVertices > UINT32_MAX)
+					return false;
+
+				peakBytes = std::max(peakBytes, firstVertexOfPosition.capacity() * sizeof(uint32_t) + nextVertexOfPosition.capacity() * sizeof(uint32_t)
+					+ vertexKeys.capacity() * sizeof(OBJVertexKey) + vertexBuffer.capacity() * sizeof(Vertex) + indexBuffer.capacity() * sizeof(uint32_t));
+			}
+		}
+
+		if (!verticesFile.Close() || !indicesFile.Close())
+			return false;
+
+		const auto tangentStart{ std::chrono::high_resolution_clock::now() };
+
+		//3. Tangents, accumulated in triangle order so the cache matches the in memory parse whenever the welding took a single pass
+		const std::string tempPath{ cachePath + ".tmp" };
+		size_t nrTangentPasses{};
+		{
+			const MappedFile verticesMap{ verticesFile.path };
+			const MappedFile indicesMap{ indicesFile.path };
+
+			const Vertex* pVertices{ reinterpret_cast<const Vertex*>(verticesMap.GetData()) };
+			const uint32_t* pIndices{ reinterpret_cast<const uint32_t*>(indicesMap.GetData()) };
+
+			header.nrVertices = nrVertices;
+			header.nrIndices = nrCorners;
+			header.verticesOffset = AlignCacheOffset(sizeof(MeshCacheHeader));
+			header.indicesOffset = AlignCacheOffset(header.verticesOffset + nrVertices * sizeof(Vertex));
+
+			std::ofstream cacheFile{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!cacheFile)
+				return false;
+
+			//the header is written again once the bounds are known
+			const char padding[MeshCacheHeader::alignment]{};
+			cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			cacheFile.write(padding, static_cast<std::streamsize>(header.verticesOffset - sizeof(header)));
+
+			//vertices without a normal sum the triangle normals next to the tangents, same as the in memory parse
+			const size_t bytesPerVertex{ (hasMissingNormals ? 2 : 1) * sizeof(Vector3) + sizeof(Vertex) };
+			const size_t verticesPerPass{ std::max<size_t>(memoryBudget / bytesPerVertex, 1) };
+			nrTangentPasses = std::max<size_t>((nrVertices + verticesPerPass - 1) / verticesPerPass, 1);
+
+			const size_t nrTriangles{ nrCorners / 3 };
+			std::vector<Vector3> tangents{};
+			std::vector<Vector3> normals{};
+			std::vector<Vertex> vertices{};
+
+			for (size_t passIdx{}; passIdx < nrTangentPasses; ++passIdx)
+			{
+				const size_t firstVertex{ passIdx * verticesPerPass };
+				const size_t lastVertex{ std::min(nrVertices, firstVertex + verticesPerPass) };
+				const auto isInPass{ [firstVertex, lastVertex](uint32_t vertexIdx) { return vertexIdx >= firstVertex && vertexIdx < lastVertex; } };
+
+				tangents.assign(lastVertex - firstVertex, Vector3{});
+				normals.assign(hasMissingNormals ? lastVertex - firstVertex : 0, Vector3{});
+				for (size_t triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+				{
+					if ((triangleIdx & 0xFFFFF) == 0)
+					{
+						reportProgress(MeshStreamingStage::TANGENTS, passIdx * nrTriangles + triangleIdx, nrTangentPasses * nrTriangles);
+					}
+
+					const uint32_t* pTriangle{ pIndices + triangleIdx * 3 };
+					if (!isInPass(pTriangle[0]) && !isInPass(pTriangle[1]) && !isInPass(pTriangle[2]))
+						continue;
+
+					const Vertex& v0{ pVertices[pTriangle[0]] };
+					const Vertex& v1{ pVertices[pTriangle[1]] };
+					const Vertex& v2{ pVertices[pTriangle[2]] };
+					const Vector3 tangent{ Utils::CalculateTriangleTangent(v0, v1, v2) };
+					const Vector3 normal{ hasMissingNormals ? Utils::CalculateTriangleNormal(v0, v1, v2, flipAxisAndWinding) : Vector3{} };
+					for (int cornerIdx{}; cornerIdx < 3; ++cornerIdx)
+					{
+						if (isInPass(pTriangle[cornerIdx]))
+						{
+							tangents[pTriangle[cornerIdx] - firstVertex] += tangent;
+							if (hasMissingNormals)
+							{
+								normals[pTriangle[cornerIdx] - firstVertex] += normal;
+							}
+						}
+					}
+				}
+
+				//Create the Tangents (reject)
+				vertices.assign(pVertices + firstVertex, pVertices + lastVertex);
+				for (size_t vertexIdx{}; vertexIdx < vertices.size(); ++vertexIdx)
+				{
+					Vertex& v{ vertices[vertexIdx] };
+					if (hasMissingNormals && Utils::IsMissingNormal(v))
+					{
+						v.normal = Utils::FinishNormal(normals[vertexIdx]);
+					}
+					v.tangent = Utils::FinishTangent(tangents[vertexIdx], v.normal);
+
+					if (flipAxisAndWinding)
+					{
+						v.position.z *= -1.f;
+						v.normal.z *= -1.f;
+						v.tangent.z *= -1.f;
+					}
+
+					const bool isFirstVertex{ firstVertex + vertexIdx == 0 };
+					header.bounds.min = isFirstVertex ? v.position : Vector3::Min(header.bounds.min, v.position);
+					header.bounds.max = isFirstVertex ? v.position : Vector3::Max(header.bounds.max, v.position);
+				}
+
+				cacheFile.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(Vertex)));
+
+				peakBytes = std::max(peakBytes, (tangents.capacity() + normals.capacity()) * sizeof(Vector3) + vertices.capacity() * sizeof(Vertex));
+			}
+
+			cacheFile.write(padding, static_cast<std::streamsize>(header.indicesOffset - header.verticesOffset - nrVertices * sizeof(Vertex)));
+			if (nrCorners > 0)
+			{
+				cacheFile.write(indicesMap.GetData(), static_cast<std::streamsize>(nrCorners * sizeof(uint32_t)));
+			}
+
+			cacheFile.seekp(0);
+			cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (!cacheFile)
+				return false;
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		if (pStats)
+		{
+			const auto end{ std::chrono::high_resolution_clock::now() };
+
+			pStats->parseStats.nrFaceCorners = nrCorners;
+			pStats->parseStats.nrVertices = nrVertices;
+			pStats->parseStats.parseMilliseconds = std::chrono::duration<double, std::milli>(weldStart - parseStart).count();
+			pStats->parseStats.weldMilliseconds = std::chrono::duration<double, std::milli>(tangentStart - weldStart).count();
+			pStats->parseStats.tangentMilliseconds = std::chrono::duration<double, std::milli>(end - tangentStart).count();
+			pStats->nrStreamingPasses = nrWeldPasses + nrTangentPasses;
+			pStats->peakStreamingBytes = peakBytes;
+		}
+
+		return true;
+	}
+
+	//Simplifies the optimized mesh level after level & appends every level's indices & meshlets, the vertices stay shared
+	//The chain stops once a level removes less than a tenth of the triangles, seams & borders only let a mesh simplify so far
+	static void BuildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices,
+		std::vector<MeshLod>& lods, const MeshOptimizationSettings& settings)
+	{
+		constexpr float minReduction{ 0.9f };
+
+		lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0, static_cast<uint32_t>(meshlets.size()), 0.f });
+
+		std::vector<uint32_t> lodIndices(indices);
+		while (lods.size() < settings.maxNrLods)
+		{
+			const size_t targetNrIndices{ static_cast<size_t>(lodIndices.size() / 3 * settings.lodReduction) * 3 };
+
+			float error{};
+			std::vector<uint32_t> simplifiedIndices{ MeshSimplifier::Simplify(vertices, lodIndices, targetNrIndices, &error) };
+			if (simplifiedIndices.empty() || simplifiedIndices.size() > lodIndices.size() * minReduction)
+				break;
+
+			//same treatment as the full mesh, only the vertex order is left alone as the levels share it
+			std::vector<uint32_t> clusterStarts{};
+			lodIndices = MeshOptimizer::OptimizeVertexCache(simplifiedIndices, vertices.size(), settings.cacheSize, clusterStarts);
+
+			std::vector<uint32_t> lodMeshletIndices{};
+			std::vector<uint32_t> lodMeshletVertices{};
+			std::vector<Meshlet> lodMeshlets{ MeshletBuilder::Build(vertices, lodIndices, lodMeshletIndices, lodMeshletVertices) };
+			lodIndices = std::move(lodMeshletIndices);
+
+			//the triangles stay relative to the level, only the meshlet vertices end up in one list
+			const uint32_t firstMeshletVertex{ static_cast<uint32_t>(meshletVertices.size()) };
+			for (Meshlet& meshlet : lodMeshlets)
+			{
+				meshlet.firstVertex += firstMeshletVertex;
+			}
+
+			//the errors add up, every level is simplified from the one before it
+			lods.push_back(MeshLod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()),
+				static_cast<uint32_t>(meshlets.size()), static_cast<uint32_t>(lodMeshlets.size()), lods.back().error + error });
+
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+			meshlets.insert(meshlets.end(), lodMeshlets.begin(), lodMeshlets.end());
+			meshletVertices.insert(meshletVertices.end(), lodMeshletVertices.begin(), lodMeshletVertices.end());
+		}
+	}
+
+	//Maps cachePath when it's a valid cache of the source described by sourceHeader, the source only gets hashed when its size or write time changed
+	static MappedFile* MapUpToDateCache(const std::string& cachePath, const std::string& filename, const MeshCacheHeader& sourceHeader, bool hasSource, ThreadPool* pThreadPool, uint64_t& sourceHash, bool& isSourceHashed, MeshCacheHeader& cacheHeader)
+	{
+		MappedFile* pCacheFile{ new MappedFile{ cachePath } };
+		if (pCacheFile->IsValid() && pCacheFile->GetSize() >= sizeof(MeshCacheHeader))
+		{
+			memcpy(&cacheHeader, pCacheFile->GetData(), sizeof(cacheHeader));
+
+			bool isUpToDate{ IsCacheHeaderValid(cacheHeader, pCacheFile->GetSize(), sourceHeader) };
+			bool isTouched{ false };
+			if (isUpToDate && hasSource && (cacheHeader.sourceSize != sourceHeader.sourceSize || cacheHeader.sourceWriteTime != sourceHeader.sourceWriteTime))
+			{
+				//touched (e.g. checked out again), only rebuild when the content actually changed
+				if (!isSourceHashed)
+				{
+					const MappedFile sourceFile{ filename };
+					sourceHash = sourceFile.IsValid() ? HashFileContent(sourceFile, pThreadPool) : 0;
+					isSourceHashed = true;
+				}
+
+				isUpToDate = cacheHeader.sourceSize == sourceHeader.sourceSize && cacheHeader.sourceHash == sourceHash;
+				isTouched = isUpToDate;
+			}
+
+			//a cache that doesn't hold together is rebuilt like an outdated one
+			if (isUpToDate && !IsCacheContentValid(cacheHeader, pCacheFile->GetData()))
+			{
+				std::cout << "Rebuilding invalid mesh cache " << cachePath << "\n";
+				isUpToDate = false;
+			}
+
+			//the cache takes over the new write time, so only the first load after a touch pays for hashing the source
+			//the mapping keeps the file open read-only, it's mapped again once the header is rewritten
+			if (isUpToDate && isTouched)
+			{
+				const size_t cacheSize{ pCacheFile->GetSize() };
+				delete pCacheFile;
+
+				cacheHeader.sourceWriteTime = sourceHeader.sourceWriteTime;
+				if (!RewriteCacheHeader(cachePath, cacheHeader))
+				{
+					std::cout << "Failed to update mesh cache " << cachePath << "\n";
+				}
+
+				pCacheFile = new MappedFile{ cachePath };
+				isUpToDate = pCacheFile->IsValid() && pCacheFile->GetSize() == cacheSize;
+			}
+
+			if (isUpToDate)
+				return pCacheFile;
+		}
+
+		delete pCacheFile;
+		return nullptr;
+	}
+
+	MeshData::MeshData(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Meshlet>&& meshlets, std::vector<uint32_t>&& meshletVertices,
+		std::vector<MeshLod>&& lods)
+		: m_OwnedVertices{ std::move(vertices) }
+		, m_OwnedIndices{ std::move(indices) }
+		, m_OwnedMeshlets{ std::move(meshlets) }
+		, m_OwnedMeshletVertices{ std::move(meshletVertices) }
+		, m_OwnedLods{ std::move(lods) }
+		, m_Vertices{ m_OwnedVertices }
+		, m_Indices{ m_OwnedIndices }
+		, m_Meshlets{ m_OwnedMeshlets }
+		, m_MeshletVertices{ m_OwnedMeshletVertices }
+		, m_Lods{ m_OwnedLods }
+	{
+		if (m_Vertices.empty())
+			return;
+
+		m_Bounds.min = m_Bounds.max = m_Vertices[0].position;
+		for (const Vertex& vertex : m_Vertices)
+		{
+			m_Bounds.min = Vector3::Min(m_Bounds.min, vertex.position);
+			m_Bounds.max = Vector3::Max(m_Bounds.max, vertex.position);
+		}
+	}
+	MeshData::MeshData(MappedFile* pMappedFile, std::span<const Vertex> vertices, std::span<const uint32_t> indices, const MeshBounds& bounds,
+		std::span<const Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const MeshLod> lods)
+		: m_pMappedFile{ pMappedFile }
+		, m_Vertices{ vertices }
+		, m_Indices{ indices }
+		, m_Bounds{ bounds }
+		, m_Meshlets{ meshlets }
+		, m_MeshletVertices{ meshletVertices }
+		, m_Lods{ lods }
+	{
+	}
+	MeshData::~MeshData()
+	{
+		delete m_pMappedFile;
+	}
+
+	std::string MeshData::GetCachePath(const std::string& filename)
+	{
+		return std::filesystem::path{ filename }.replace_extension(".mesh").string();
+	}
+
+	MeshData* MeshData::LoadOBJ(const std::string& filename, bool flipAxisAndWinding, ThreadPool* pThreadPool, MeshLoadStats* pStats, const MeshStreamingSettings* pStreamingSettings, const MeshOptimizationSettings* pOptimizationSettings)
+	{
+		const auto loadStart{ std::chrono::high_resolution_clock::now() };
+		const std::string cachePath{ GetCachePath(filename) };
+
+		MeshCacheHeader header{};
+		header.flags = flipAxisAndWinding ? MeshCacheHeader::flipAxisAndWindingFlag : 0;
+		if (pOptimizationSettings)
+		{
+			header.flags |= MeshCacheHeader::optimizedFlag;
+			header.optimizationSettings = *pOptimizationSettings;
+		}
+
+		//Identify the source, a missing source is fine as long as there's a cache for it
+		std::error_code error{};
+		const bool hasSource{ std::filesystem::exists(filename, error) };
+		if (hasSource)
+		{
+			header.sourceSize = std::filesystem::file_size(filename, error);
+			header.sourceWriteTime = static_cast<int64_t>(std::filesystem::last_write_time(filename, error).time_since_epoch().count());
+		}
+
+		MeshData* pMeshData{};
+		uint64_t sourceHash{};
+		bool isSourceHashed{ false };
+
+		//1. Try the cache, the vertices & indices are used right where they're mapped
+		MeshCacheHeader cacheHeader{};
+		MappedFile* pCacheFile{ MapUpToDateCache(cachePath, filename, header, hasSource, pThreadPool, sourceHash, isSourceHashed, cacheHeader) };
+
+		if (pStats)
+		{
+			pStats->isFromCache = pCacheFile != nullptr;
+			pStats->isCacheWritten = false;
+			pStats->isStreamed = false;
+			pStats->isOptimized = false;
+		}
+
+		//2. Rebuild the cache, out of core when parsing in memory would take more than the budget (roughly twice the OBJ's size)
+		if (!pCacheFile && hasSource)
+		{
+			if (!isSourceHashed)
+			{
+				const MappedFile sourceFile{ filename };
+				sourceHash = sourceFile.IsValid() ? HashFileContent(sourceFile, pThreadPool) : 0;
+			}
+			header.sourceHash = sourceHash;
+
+			const bool isStreamed{ pStreamingSettings && (pStreamingSettings->isForced || header.sourceSize * 2 > pStreamingSettings->memoryBudget) };
+			if (isStreamed)
+			{
+				if (!BuildMeshCacheOutOfCore(filename, cachePath, header, *pStreamingSettings, pThreadPool, pStats))
+					return nullptr;
+
+				pCacheFile = MapUpToDateCache(cachePath, filename, header, hasSource, pThreadPool, sourceHash, isSourceHashed, cacheHeader);
+				if (!pCacheFile)
+					return nullptr;
+
+				if (pStats)
+				{
+					pStats->isCacheWritten = true;
+					pStats->isStreamed = true;
+				}
+			}
+			else
+			{
+				std::vector<Vertex> vertices{};
+				std::vector<uint32_t> indices{};
+				if (!Utils::ParseOBJ(filename, vertices, indices, flipAxisAndWinding, pStats ? &pStats->parseStats : nullptr, pThreadPool))
+					return nullptr;
+
+				std::vector<Meshlet> meshlets{};
+				std::vector<uint32_t> meshletVertices{};
+				std::vector<MeshLod> lods{};
+				if (pOptimizationSettings)
+				{
+					MeshOptimizer::Optimize(vertices, indices, *pOptimizationSettings, &header.optimizationStats);
+
+					//meshlets regroup the optimized triangles once more, so the cache stats are measured again afterwards
+					const auto meshletStart{ std::chrono::high_resolution_clock::now() };
+
+					std::vector<uint32_t> meshletIndices{};
+					meshlets = MeshletBuilder::Build(vertices, indices, meshletIndices, meshletVertices);
+					indices = std::move(meshletIndices);
+
+					header.optimizationStats.after = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size(), pOptimizationSettings->cacheSize);
+
+					BuildLods(vertices, indices, meshlets, meshletVertices, lods, *pOptimizationSettings);
+
+					header.optimizationStats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - meshletStart).count();
+				}
+
+				pMeshData = new MeshData{ std::move(vertices), std::move(indices), std::move(meshlets), std::move(meshletVertices), std::move(lods) };
+
+				header.nrVertices = pMeshData->m_Vertices.size();
+				header.nrIndices = pMeshData->m_Indices.size();
+				header.nrMeshlets = pMeshData->m_Meshlets.size();
+				header.nrMeshletVertices = pMeshData->m_MeshletVertices.size();
+				header.nrLods = pMeshData->m_Lods.size();
+				header.verticesOffset = AlignCacheOffset(sizeof(MeshCacheHeader));
+				header.indicesOffset = AlignCacheOffset(header.verticesOffset + pMeshData->m_Vertices.size_bytes());
+				header.meshletsOffset = AlignCacheOffset(header.indicesOffset + pMeshData->m_Indices.size_bytes());
+				header.meshletVerticesOffset = AlignCacheOffset(header.meshletsOffset + pMeshData->m_Meshlets.size_bytes());
+				header.lodsOffset = AlignCacheOffset(header.meshletVerticesOffset + pMeshData->m_MeshletVertices.size_bytes());
+				header.bounds = pMeshData->m_Bounds;
+
+				const bool isCacheWritten{ WriteMeshCache(cachePath, header, pMeshData->m_Vertices, pMeshData->m_Indices, pMeshData->m_Meshlets, pMeshData->m_MeshletVertices, pMeshData->m_Lods) };
+				if (!isCacheWritten)
+				{
+					std::cout << "Failed to write mesh cache " << cachePath << "\n";
+				}
+
+				if (pStats)
+				{
+					pStats->isCacheWritten = isCacheWritten;
+					pStats->isOptimized = pOptimizationSettings != nullptr;
+					pStats->optimizationStats = header.optimizationStats;
+				}
+			}
+		}
+
+		if (pCacheFile)
+		{
+			const std::span<const Vertex> vertices{ reinterpret_cast<const Vertex*>(pCacheFile->GetData() + cacheHeader.verticesOffset), static_cast<size_t>(cacheHeader.nrVertices) };
+			const std::span<const uint32_t> indices{ reinterpret_cast<const uint32_t*>(pCacheFile->GetData() + cacheHeader.indicesOffset), static_cast<size_t>(cacheHeader.nrIndices) };
+			std::span<const Meshlet> meshlets{ reinterpret_cast<const Meshlet*>(pCacheFile->GetData() + cacheHeader.meshletsOffset), static_cast<size_t>(cacheHeader.nrMeshlets) };
+			const std::span<const uint32_t> meshletVertices{ reinterpret_cast<const uint32_t*>(pCacheFile->GetData() + cacheHeader.meshletVerticesOffset), static_cast<size_t>(cacheHeader.nrMeshletVertices) };
+			std::span<const MeshLod> lods{ reinterpret_cast<const MeshLod*>(pCacheFile->GetData() + cacheHeader.lodsOffset), static_cast<size_t>(cacheHeader.nrLods) };
+
+			//a broken level only costs the levels, the mesh itself is still fine
+			if (!AreCacheLodsValid(lods, cacheHeader.nrIndices, cacheHeader.nrMeshlets))
+			{
+				std::cout << "Ignoring invalid levels of detail in mesh cache " << cachePath << "\n";
+				lods = {};
+				meshlets = {}; //their triangles count from levels that are gone now
+			}
+
+			pMeshData = new MeshData{ pCacheFile, vertices, indices, cacheHeader.bounds, meshlets, meshletVertices, lods };
+
+			if (pStats)
+			{
+				pStats->isOptimized = (cacheHeader.flags & MeshCacheHeader::optimizedFlag) != 0;
+				pStats->optimizationStats = cacheHeader.optimizationStats;
+			}
+		}
+
+		if (pStats)
+		{
+			pStats->loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		}
+
+		return pMeshData;
+	}
+}
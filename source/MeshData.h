@@ -0,0 +1,105 @@
+#pragma once
+#include "Utils.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+
+namespace dae
+{
+	class MappedFile;
+	class ThreadPool;
+
+	struct MeshBounds
+	{
+		Vector3 min{};
+		Vector3 max{};
+	};
+
+	//Range of the index & meshlet lists making up one level of detail, level 0 is the full mesh & every level after it is coarser
+	struct MeshLod
+	{
+		uint32_t firstIndex{};
+		uint32_t nrIndices{};
+		uint32_t firstMeshlet{};
+		uint32_t nrMeshlets{};
+		float error{}; //how far the surface may lie from the full mesh, in object space
+	};
+
+	enum class MeshStreamingStage
+	{
+		PARSING,
+		WELDING,
+		TANGENTS,
+	};
+
+	struct MeshStreamingSettings
+	{
+		//heap memory the streaming passes try to stay under, the spill files they read back are mapped & paged by the OS
+		size_t memoryBudget{ size_t{ 1 } << 30 };
+		bool isForced{ false }; //stream even when parsing in memory would fit the budget
+		std::function<void(MeshStreamingStage stage, float progress)> progressCallback{};
+	};
+
+	struct MeshLoadStats
+	{
+		bool isFromCache{};
+		bool isCacheWritten{};
+		bool isStreamed{};
+		size_t nrStreamingPasses{}; //weld & tangent passes, 2 when everything fit the budget at once
+		size_t peakStreamingBytes{};
+		bool isOptimized{};
+		MeshOptimizationStats optimizationStats{}; //kept in the cache, so also filled in when the mesh came from there
+		double loadMilliseconds{}; //everything, from checking the cache to having the vertices & indices
+		Utils::OBJParseStats parseStats{}; //only filled in when the OBJ had to be parsed
+	};
+
+	//Welded vertices & indices of a mesh, either owned or mapped straight out of a binary mesh cache file
+	class MeshData final
+	{
+	public:
+		MeshData(std::vector<Vertex>&& vertices, std::vector<uint32_t>&& indices, std::vector<Meshlet>&& meshlets = {}, std::vector<uint32_t>&& meshletVertices = {},
+			std::vector<MeshLod>&& lods = {});
+		~MeshData();
+
+		MeshData(const MeshData&) = delete;
+		MeshData(MeshData&&) noexcept = delete;
+		MeshData& operator=(const MeshData&) = delete;
+		MeshData& operator=(MeshData&&) noexcept = delete;
+
+		//Maps the OBJ's binary cache when it's still up to date, otherwise parses the OBJ & writes the cache for next time
+		//With streaming settings, OBJs too big to parse within the memory budget are built into the cache out of core & mapped from there
+		//With optimization settings, the triangles & vertices are reordered before they're cached (streamed meshes are left as they are)
+		//and the triangles are grouped in meshlets, optimized meshes are the only ones that have meshlets & levels of detail
+		static MeshData* LoadOBJ(const std::string& filename, bool flipAxisAndWinding = true, ThreadPool* pThreadPool = nullptr, MeshLoadStats* pStats = nullptr,
+			const MeshStreamingSettings* pStreamingSettings = nullptr, const MeshOptimizationSettings* pOptimizationSettings = nullptr);
+		static std::string GetCachePath(const std::string& filename);
+
+		std::span<const Vertex> GetVertices() const { return m_Vertices; }
+		std::span<const uint32_t> GetIndices() const { return m_Indices; }
+		const MeshBounds& GetBounds() const { return m_Bounds; }
+		std::span<const Meshlet> GetMeshlets() const { return m_Meshlets; }
+		std::span<const uint32_t> GetMeshletVertices() const { return m_MeshletVertices; }
+		//all levels share the vertices, each one is a range of the indices (& of the meshlets, their triangles count from the level's first index)
+		std::span<const MeshLod> GetLods() const { return m_Lods; }
+
+		bool IsMapped() const { return m_pMappedFile != nullptr; }
+
+	private:
+		//takes ownership of the (already validated) cache file
+		MeshData(MappedFile* pMappedFile, std::span<const Vertex> vertices, std::span<const uint32_t> indices, const MeshBounds& bounds,
+			std::span<const Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const MeshLod> lods);
+
+		std::vector<Vertex> m_OwnedVertices{};
+		std::vector<uint32_t> m_OwnedIndices{};
+		std::vector<Meshlet> m_OwnedMeshlets{};
+		std::vector<uint32_t> m_OwnedMeshletVertices{};
+		std::vector<MeshLod> m_OwnedLods{};
+		MappedFile* m_pMappedFile{};
+
+		std::span<const Vertex> m_Vertices{};
+		std::span<const uint32_t> m_Indices{};
+		MeshBounds m_Bounds{};
+		std::span<const Meshlet> m_Meshlets{};
+		std::span<const uint32_t> m_MeshletVertices{};
+		std::span<const MeshLod> m_Lods{};
+	};
+}
@@ -0,0 +1,331 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+#include "MeshUtils.h"
+#include <chrono>
+
+namespace dae::MeshOptimizer
+{
+	//FIFO cache where every miss gets the next time stamp, a vertex is still cached while less than cacheSize misses happened since its own
+	struct VertexCache
+	{
+		VertexCache(size_t nrVertices, uint32_t cacheSize)
+			: timeStamps(nrVertices, 0)
+			, size{ cacheSize }
+			, time{ cacheSize + 1 }
+		{
+		}
+
+		//returns whether it was a miss
+		bool Access(uint32_t vertexIdx)
+		{
+			if (time - timeStamps[vertexIdx] <= size)
+				return false;
+
+			timeStamps[vertexIdx] = time++;
+			return true;
+		}
+		void Flush()
+		{
+			time += size + 1;
+		}
+
+		std::vector<uint32_t> timeStamps{};
+		uint32_t size{};
+		uint32_t time{};
+	};
+
+	VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t nrVertices, uint32_t cacheSize)
+	{
+		VertexCache cache{ nrVertices, cacheSize };
+
+		size_t nrMisses{};
+		for (const uint32_t vertexIdx : indices)
+		{
+			nrMisses += cache.Access(vertexIdx);
+		}
+
+		VertexCacheStats stats{};
+		stats.ACMR = static_cast<float>(nrMisses) / static_cast<float>(std::max<size_t>(indices.size() / 3, 1));
+		stats.ATVR = static_cast<float>(nrMisses) / static_cast<float>(std::max<size_t>(nrVertices, 1));
+		return stats;
+	}
+
+	std::vector<uint32_t> OptimizeVertexCache(std::span<const uint32_t> indices, size_t nrVertices, uint32_t cacheSize, std::vector<uint32_t>& clusterStarts)
+	{
+		const size_t nrTriangles{ indices.size() / 3 };
+
+		//Triangles around every vertex
+		std::vector<uint32_t> adjacencyOffsets{};
+		std::vector<uint32_t> adjacentTriangles{};
+		MeshUtils::BuildTriangleAdjacency(indices, nrVertices, [](uint32_t vertexIdx) { return vertexIdx; }, adjacencyOffsets, adjacentTriangles);
+
+		std::vector<uint32_t> liveTriangles(nrVertices);
+		for (size_t vertexIdx{}; vertexIdx < nrVertices; ++vertexIdx)
+		{
+			liveTriangles[vertexIdx] = adjacencyOffsets[vertexIdx + 1] - adjacencyOffsets[vertexIdx];
+		}
+
+		std::vector<uint32_t> optimizedIndices{};
+		optimizedIndices.reserve(indices.size());
+		clusterStarts.clear();
+
+		constexpr uint32_t noVertex{ UINT32_MAX };
+		std::vector<uint32_t> timeStamps(nrVertices, 0);
+		std::vector<bool> isEmitted(nrTriangles, false);
+		std::vector<uint32_t> deadEndStack{};
+		std::vector<uint32_t> candidates{};
+
+		uint32_t time{ cacheSize + 1 };
+		uint32_t cursor{}; //every vertex before it has no live triangles left
+
+		const auto skipDeadEnd{ [&]() -> uint32_t
+			{
+				//recently used vertices that still have live triangles first, otherwise the next one in input order
+				while (!deadEndStack.empty())
+				{
+					const uint32_t vertexIdx{ deadEndStack.back() };
+					deadEndStack.pop_back();
+					if (liveTriangles[vertexIdx] > 0)
+						return vertexIdx;
+				}
+				while (cursor < nrVertices)
+				{
+					if (liveTriangles[cursor] > 0)
+						return cursor;
+					++cursor;
+				}
+				return noVertex;
+			} };
+
+		uint32_t fanningVertex{ nrVertices > 0 ? 0 : noVertex };
+		bool isNewCluster{ true };
+		while (fanningVertex != noVertex)
+		{
+			//a dead end right after another one (a vertex without live triangles) doesn't make an empty cluster
+			const uint32_t nrEmittedTriangles{ static_cast<uint32_t>(optimizedIndices.size() / 3) };
+			if (isNewCluster && (clusterStarts.empty() || clusterStarts.back() != nrEmittedTriangles))
+			{
+				clusterStarts.push_back(nrEmittedTriangles);
+			}
+			isNewCluster = false;
+
+			//Emit every live triangle around the fanning vertex
+			candidates.clear();
+			for (uint32_t adjacencyIdx{ adjacencyOffsets[fanningVertex] }; adjacencyIdx < adjacencyOffsets[fanningVertex + 1]; ++adjacencyIdx)
+			{
+				const uint32_t triangleIdx{ adjacentTriangles[adjacencyIdx] };
+				if (isEmitted[triangleIdx])
+					continue;
+
+				for (uint32_t cornerIdx{}; cornerIdx < 3; ++cornerIdx)
+				{
+					const uint32_t vertexIdx{ indices[triangleIdx * 3 + cornerIdx] };
+					optimizedIndices.push_back(vertexIdx);
+					deadEndStack.push_back(vertexIdx);
+					candidates.push_back(vertexIdx);
+					--liveTriangles[vertexIdx];
+
+					if (time - timeStamps[vertexIdx] > cacheSize)
+					{
+						timeStamps[vertexIdx] = time++;
+					}
+				}
+				isEmitted[triangleIdx] = true;
+			}
+
+			//Next fanning vertex: the oldest candidate that would still be cached after emitting its remaining triangles
+			uint32_t nextVertex{ noVertex };
+			uint32_t bestPriority{};
+			for (const uint32_t vertexIdx : candidates)
+			{
+				if (liveTriangles[vertexIdx] == 0)
+					continue;
+
+				const uint32_t age{ time - timeStamps[vertexIdx] };
+				const uint32_t priority{ (age + 2 * liveTriangles[vertexIdx] <= cacheSize) ? age : 0 };
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					nextVertex = vertexIdx;
+				}
+			}
+
+			//Dead end, whatever comes next doesn't share the cache with what came before, so it's a hard cluster boundary
+			if (nextVertex == noVertex)
+			{
+				nextVertex = skipDeadEnd();
+				isNewCluster = true;
+			}
+
+			fanningVertex = nextVertex;
+		}
+
+		return optimizedIndices;
+	}
+
+	std::vector<uint32_t> OptimizeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices, const std::vector<uint32_t>& clusterStarts, uint32_t cacheSize, float threshold)
+	{
+		const uint32_t nrTriangles{ static_cast<uint32_t>(indices.size() / 3) };
+		VertexCache cache{ vertices.size(), cacheSize };
+
+		const auto countMisses{ [&](uint32_t triangleIdx)
+			{
+				return static_cast<uint32_t>(cache.Access(indices[triangleIdx * 3])) + cache.Access(indices[triangleIdx * 3 + 1]) + cache.Access(indices[triangleIdx * 3 + 2]);
+			} };
+
+		//1. Soft boundaries, a new cluster starts every time the running ACMR (from an empty cache) drops below the threshold times the cluster's own ACMR
+		std::vector<uint32_t> softStarts{};
+		for (size_t clusterIdx{}; clusterIdx < clusterStarts.size(); ++clusterIdx)
+		{
+			const uint32_t clusterStart{ clusterStarts[clusterIdx] };
+			const uint32_t clusterEnd{ (clusterIdx + 1 < clusterStarts.size()) ? clusterStarts[clusterIdx + 1] : nrTriangles };
+
+			cache.Flush();
+			uint32_t clusterMisses{};
+			for (uint32_t triangleIdx{ clusterStart }; triangleIdx < clusterEnd; ++triangleIdx)
+			{
+				clusterMisses += countMisses(triangleIdx);
+			}
+			const float clusterThreshold{ threshold * static_cast<float>(clusterMisses) / static_cast<float>(std::max(clusterEnd - clusterStart, 1u)) };
+
+			const size_t firstSoftStart{ softStarts.size() };
+			softStarts.push_back(clusterStart);
+
+			cache.Flush();
+			uint32_t runningMisses{};
+			uint32_t runningTriangles{};
+			for (uint32_t triangleIdx{ clusterStart }; triangleIdx < clusterEnd; ++triangleIdx)
+			{
+				runningMisses += countMisses(triangleIdx);
+				++runningTriangles;
+
+				if (static_cast<float>(runningMisses) <= clusterThreshold * static_cast<float>(runningTriangles))
+				{
+					softStarts.push_back(triangleIdx + 1);
+
+					cache.Flush();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+
+			//the last piece is whatever didn't reach the threshold anymore, it's merged into the one before it instead of standing on its own
+			if (softStarts.size() - firstSoftStart > 1)
+			{
+				softStarts.pop_back();
+			}
+		}
+
+		//2. Occlusion potential, clusters far out along their own normal probably cover the ones behind them from most directions
+		struct Cluster
+		{
+			uint32_t start{};
+			uint32_t end{};
+			float sortKey{};
+		};
+		std::vector<Cluster> clusters(softStarts.size());
+
+		Vector3 meshCentroid{};
+		float meshArea{};
+		std::vector<Vector3> clusterCentroids(clusters.size());
+		std::vector<Vector3> clusterNormals(clusters.size());
+		for (size_t clusterIdx{}; clusterIdx < clusters.size(); ++clusterIdx)
+		{
+			Cluster& cluster{ clusters[clusterIdx] };
+			cluster.start = softStarts[clusterIdx];
+			cluster.end = (clusterIdx + 1 < softStarts.size()) ? softStarts[clusterIdx + 1] : nrTriangles;
+
+			Vector3 areaWeightedCentroid{};
+			float clusterArea{};
+			for (uint32_t triangleIdx{ cluster.start }; triangleIdx < cluster.end; ++triangleIdx)
+			{
+				const Vertex& v0{ vertices[indices[triangleIdx * 3]] };
+				const Vertex& v1{ vertices[indices[triangleIdx * 3 + 1]] };
+				const Vertex& v2{ vertices[indices[triangleIdx * 3 + 2]] };
+
+				//the vertex normals decide which side is out, so this doesn't depend on the winding order
+				const float area{ Vector3::Cross(v1.position - v0.position, v2.position - v0.position).Magnitude() * 0.5f };
+				areaWeightedCentroid += (v0.position + v1.position + v2.position) * (area / 3.f);
+				clusterNormals[clusterIdx] += (v0.normal + v1.normal + v2.normal) * area;
+				clusterArea += area;
+			}
+
+			clusterCentroids[clusterIdx] = (clusterArea > 0.f) ? areaWeightedCentroid / clusterArea : vertices[indices[cluster.start * 3]].position;
+			clusterNormals[clusterIdx].Normalize();
+
+			meshCentroid += areaWeightedCentroid;
+			meshArea += clusterArea;
+		}
+		if (meshArea > 0.f)
+		{
+			meshCentroid = meshCentroid / meshArea;
+		}
+
+		for (size_t clusterIdx{}; clusterIdx < clusters.size(); ++clusterIdx)
+		{
+			clusters[clusterIdx].sortKey = Vector3::Dot(clusterCentroids[clusterIdx] - meshCentroid, clusterNormals[clusterIdx]);
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> optimizedIndices{};
+		optimizedIndices.reserve(indices.size());
+		for (const Cluster& cluster : clusters)
+		{
+			optimizedIndices.insert(optimizedIndices.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+		}
+
+		return optimizedIndices;
+	}
+
+	void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		constexpr uint32_t unused{ UINT32_MAX };
+		std::vector<uint32_t> remap(vertices.size(), unused);
+
+		std::vector<Vertex> orderedVertices{};
+		orderedVertices.reserve(vertices.size());
+
+		for (uint32_t& vertexIdx : indices)
+		{
+			if (remap[vertexIdx] == unused)
+			{
+				remap[vertexIdx] = static_cast<uint32_t>(orderedVertices.size());
+				orderedVertices.push_back(vertices[vertexIdx]);
+			}
+			vertexIdx = remap[vertexIdx];
+		}
+
+		//vertices no triangle uses end up at the back
+		for (size_t vertexIdx{}; vertexIdx < vertices.size(); ++vertexIdx)
+		{
+			if (remap[vertexIdx] == unused)
+			{
+				orderedVertices.push_back(vertices[vertexIdx]);
+			}
+		}
+
+		vertices = std::move(orderedVertices);
+	}
+
+	void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizationSettings& settings, MeshOptimizationStats* pStats)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+
+		if (pStats)
+		{
+			pStats->before = AnalyzeVertexCache(indices, vertices.size(), settings.cacheSize);
+		}
+
+		std::vector<uint32_t> clusterStarts{};
+		indices = OptimizeVertexCache(indices, vertices.size(), settings.cacheSize, clusterStarts);
+		indices = OptimizeOverdraw(indices, vertices, clusterStarts, settings.cacheSize, settings.overdrawThreshold);
+		OptimizeVertexFetch(vertices, indices);
+
+		if (pStats)
+		{
+			pStats->after = AnalyzeVertexCache(indices, vertices.size(), settings.cacheSize);
+			pStats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+}
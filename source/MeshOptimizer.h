@@ -0,0 +1,42 @@
+#pragma once
+
+namespace dae
+{
+	struct MeshOptimizationSettings
+	{
+		uint32_t cacheSize{ 16 }; //FIFO post transform cache the triangle order is tuned for & measured with
+		float overdrawThreshold{ 1.05f }; //how much worse than the cache optimized order a cluster's ACMR may get to cut down on overdraw
+		uint32_t maxNrLods{ 5 }; //levels of detail including the mesh itself, the chain stops early once a level hardly simplifies anymore
+		float lodReduction{ 0.5f }; //every level aims for this fraction of the triangles of the one before it
+	};
+
+	//Post transform cache efficiency: ACMR is cache misses per triangle (0.5 is ideal), ATVR cache misses per vertex (1 is ideal)
+	struct VertexCacheStats
+	{
+		float ACMR{};
+		float ATVR{};
+	};
+
+	struct MeshOptimizationStats
+	{
+		VertexCacheStats before{};
+		VertexCacheStats after{};
+		double milliseconds{};
+	};
+
+	//Reorders a triangle list for the post transform cache, for overdraw & for vertex fetch, in that order
+	//The triangles & vertices stay the same, only their order changes
+	namespace MeshOptimizer
+	{
+		void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizationSettings& settings, MeshOptimizationStats* pStats = nullptr);
+
+		VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, size_t nrVertices, uint32_t cacheSize);
+
+		//Tipsify (Sander et al. 2007), every dead end starts a new cluster in clusterStarts (first triangle of each cluster)
+		std::vector<uint32_t> OptimizeVertexCache(std::span<const uint32_t> indices, size_t nrVertices, uint32_t cacheSize, std::vector<uint32_t>& clusterStarts);
+		//Splits the clusters further as long as they keep their ACMR within the threshold, then draws the ones most likely to occlude the rest first
+		std::vector<uint32_t> OptimizeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices, const std::vector<uint32_t>& clusterStarts, uint32_t cacheSize, float threshold);
+		//Renumbers the vertices in the order the indices first use them
+		void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	}
+}
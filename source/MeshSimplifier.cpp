@@ -0,0 +1,390 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "MeshUtils.h"
+#include <numeric>
+#include <tuple>
+
+namespace dae::MeshSimplifier
+{
+	//borders get an extra plane through every border edge, standing up straight on its triangle & weighted this much heavier than the surface
+	static constexpr double BorderWeight{ 10.0 };
+	//a collapse may turn the triangles around it by up to ~78 degrees, any more & they usually fold over
+	static constexpr float MinNormalDot{ 0.2f };
+	//every pass only collapses edges that don't touch each other, so it takes a couple of them to halve a mesh
+	static constexpr int MaxNrPasses{ 64 };
+
+	enum class PositionKind : uint8_t
+	{
+		INTERIOR,
+		BORDER, //on an edge only one triangle uses, only collapses along the border
+		LOCKED, //on an edge more than two triangles use, never collapses
+	};
+
+	//Sum of the squared distances to a set of weighted planes as v^T A v + 2 b.v + c, A is symmetric so only half of it is kept
+	struct Quadric
+	{
+		double a00{}, a01{}, a02{}, a11{}, a12{}, a22{};
+		double b0{}, b1{}, b2{};
+		double c{};
+		double weight{};
+
+		void AddPlane(const Vector3& normal, const float distance, const double planeWeight)
+		{
+			const double x{ normal.x };
+			const double y{ normal.y };
+			const double z{ normal.z };
+			const double d{ distance };
+
+			a00 += planeWeight * x * x;
+			a01 += planeWeight * x * y;
+			a02 += planeWeight * x * z;
+			a11 += planeWeight * y * y;
+			a12 += planeWeight * y * z;
+			a22 += planeWeight * z * z;
+			b0 += planeWeight * x * d;
+			b1 += planeWeight * y * d;
+			b2 += planeWeight * z * d;
+			c += planeWeight * d * d;
+			weight += planeWeight;
+		}
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00;
+			a01 += other.a01;
+			a02 += other.a02;
+			a11 += other.a11;
+			a12 += other.a12;
+			a22 += other.a22;
+			b0 += other.b0;
+			b1 += other.b1;
+			b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		//weighted average distance to the planes, in object space
+		float Evaluate(const Vector3& position) const
+		{
+			if (weight <= 0.0)
+				return 0.f;
+
+			const double x{ position.x };
+			const double y{ position.y };
+			const double z{ position.z };
+
+			const double error
+			{
+				a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z)
+				+ c
+			};
+			return static_cast<float>(sqrt(std::max(error, 0.0) / weight));
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t fromPosition{};
+		uint32_t toPosition{};
+		float error{};
+	};
+
+	static uint64_t GetEdgeKey(uint32_t positionA, uint32_t positionB)
+	{
+		return (static_cast<uint64_t>(std::min(positionA, positionB)) << 32) | std::max(positionA, positionB);
+	}
+
+	std::vector<uint32_t> Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetNrIndices, float* pError)
+	{
+		const size_t nrVertices{ vertices.size() };
+
+		//Vertices split on uv or normal seams still share their position, the edges that get collapsed are between positions
+		std::vector<uint32_t> positionIds{};
+		const std::vector<Vector3> positions{ MeshUtils::WeldPositions(vertices, positionIds) };
+		const size_t nrPositions{ positions.size() };
+
+		const auto isDegenerate{ [&](const uint32_t* pTriangle)
+			{
+				const uint32_t position0{ positionIds[pTriangle[0]] };
+				const uint32_t position1{ positionIds[pTriangle[1]] };
+				const uint32_t position2{ positionIds[pTriangle[2]] };
+				return position0 == position1 || position1 == position2 || position2 == position0;
+			} };
+
+		//triangles without area in position space can't be collapsed any further, they're dropped straight away
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+		for (size_t i{}; i + 2 < indices.size(); i += 3)
+		{
+			if (!isDegenerate(&indices[i]))
+				result.insert(result.end(), { indices[i], indices[i + 1], indices[i + 2] });
+		}
+
+		//Edges used by a single triangle are open borders, edges used by more than two make the mesh non manifold
+		std::vector<PositionKind> positionKinds(nrPositions, PositionKind::INTERIOR);
+		std::vector<uint64_t> borderEdges{};
+		{
+			std::vector<uint64_t> edgeKeys{};
+			edgeKeys.reserve(result.size());
+			for (size_t i{}; i < result.size(); ++i)
+			{
+				const size_t nextIdx{ (i % 3 == 2) ? i - 2 : i + 1 };
+				edgeKeys.push_back(GetEdgeKey(positionIds[result[i]], positionIds[result[nextIdx]]));
+			}
+			std::sort(edgeKeys.begin(), edgeKeys.end());
+
+			for (size_t runStart{}; runStart < edgeKeys.size();)
+			{
+				size_t runEnd{ runStart + 1 };
+				while (runEnd < edgeKeys.size() && edgeKeys[runEnd] == edgeKeys[runStart])
+					++runEnd;
+
+				const uint32_t positionA{ static_cast<uint32_t>(edgeKeys[runStart] >> 32) };
+				const uint32_t positionB{ static_cast<uint32_t>(edgeKeys[runStart]) };
+				const size_t nrUses{ runEnd - runStart };
+
+				const PositionKind edgeKind{ (nrUses == 1) ? PositionKind::BORDER : (nrUses > 2) ? PositionKind::LOCKED : PositionKind::INTERIOR };
+				positionKinds[positionA] = std::max(positionKinds[positionA], edgeKind);
+				positionKinds[positionB] = std::max(positionKinds[positionB], edgeKind);
+
+				if (nrUses == 1)
+					borderEdges.push_back(edgeKeys[runStart]);
+
+				runStart = runEnd;
+			}
+		}
+
+		//Quadric per position out of the planes of the triangles around it, weighted by area
+		std::vector<Quadric> quadrics(nrPositions);
+		for (size_t i{}; i < result.size(); i += 3)
+		{
+			const uint32_t trianglePositions[3]{ positionIds[result[i]], positionIds[result[i + 1]], positionIds[result[i + 2]] };
+			const Vector3& P0{ positions[trianglePositions[0]] };
+
+			const Vector3 normal{ Vector3::Cross(positions[trianglePositions[1]] - P0, positions[trianglePositions[2]] - P0) };
+			const float length{ normal.Magnitude() };
+			if (length <= 0.f)
+				continue;
+
+			const Vector3 unitNormal{ normal / length };
+			for (const uint32_t positionIdx : trianglePositions)
+			{
+				quadrics[positionIdx].AddPlane(unitNormal, -Vector3::Dot(unitNormal, P0), length * 0.5);
+			}
+
+			//border edges keep their place through a plane along the edge, perpendicular to the triangle
+			for (int corner{}; corner < 3; ++corner)
+			{
+				const uint32_t positionA{ trianglePositions[corner] };
+				const uint32_t positionB{ trianglePositions[(corner + 1) % 3] };
+				if (!std::binary_search(borderEdges.begin(), borderEdges.end(), GetEdgeKey(positionA, positionB)))
+					continue;
+
+				const Vector3 edge{ positions[positionB] - positions[positionA] };
+				const Vector3 borderNormal{ Vector3::Cross(edge, unitNormal).Normalized() };
+				const double borderWeight{ edge.SqrMagnitude() * BorderWeight };
+
+				quadrics[positionA].AddPlane(borderNormal, -Vector3::Dot(borderNormal, positions[positionA]), borderWeight);
+				quadrics[positionB].AddPlane(borderNormal, -Vector3::Dot(borderNormal, positions[positionA]), borderWeight);
+			}
+		}
+
+		//borders only slide along themselves, so the outline stays the same
+		const auto isCollapseAllowed{ [&](uint32_t fromPosition, uint32_t toPosition)
+			{
+				switch (positionKinds[fromPosition])
+				{
+				case PositionKind::INTERIOR:
+					return true;
+
+				case PositionKind::BORDER:
+					return positionKinds[toPosition] == PositionKind::BORDER && std::binary_search(borderEdges.begin(), borderEdges.end(), GetEdgeKey(fromPosition, toPosition));
+
+				default:
+					return false;
+				}
+			} };
+
+		float maxError{};
+		std::vector<uint32_t> triangleOffsets{};
+		std::vector<uint32_t> positionTriangles{};
+		std::vector<uint64_t> edgeKeys{};
+		std::vector<Collapse> collapses{};
+		std::vector<uint32_t> vertexRemap(nrVertices);
+		std::vector<uint8_t> isPositionLocked(nrPositions);
+		std::vector<std::pair<uint32_t, uint32_t>> wedgeRemap{}; //(vertex at the from position, vertex at the to position it moves onto)
+
+		for (int passIdx{}; passIdx < MaxNrPasses && result.size() > targetNrIndices; ++passIdx)
+		{
+			const size_t nrTriangles{ result.size() / 3 };
+
+			//Triangles around every position
+			MeshUtils::BuildTriangleAdjacency(result, nrPositions, [&](uint32_t vertexIdx) { return positionIds[vertexIdx]; }, triangleOffsets, positionTriangles);
+
+			//Cheapest allowed direction of every edge, cheapest edges first
+			edgeKeys.clear();
+			for (size_t i{}; i < result.size(); ++i)
+			{
+				const size_t nextIdx{ (i % 3 == 2) ? i - 2 : i + 1 };
+				edgeKeys.push_back(GetEdgeKey(positionIds[result[i]], positionIds[result[nextIdx]]));
+			}
+			std::sort(edgeKeys.begin(), edgeKeys.end());
+			edgeKeys.erase(std::unique(edgeKeys.begin(), edgeKeys.end()), edgeKeys.end());
+
+			collapses.clear();
+			for (const uint64_t edgeKey : edgeKeys)
+			{
+				const uint32_t positionA{ static_cast<uint32_t>(edgeKey >> 32) };
+				const uint32_t positionB{ static_cast<uint32_t>(edgeKey) };
+
+				const float errorAToB{ isCollapseAllowed(positionA, positionB) ? quadrics[positionA].Evaluate(positions[positionB]) : FLT_MAX };
+				const float errorBToA{ isCollapseAllowed(positionB, positionA) ? quadrics[positionB].Evaluate(positions[positionA]) : FLT_MAX };
+
+				if (errorAToB == FLT_MAX && errorBToA == FLT_MAX)
+					continue;
+
+				collapses.push_back((errorAToB <= errorBToA) ? Collapse{ positionA, positionB, errorAToB } : Collapse{ positionB, positionA, errorBToA });
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs)
+				{
+					return std::tie(lhs.error, lhs.fromPosition, lhs.toPosition) < std::tie(rhs.error, rhs.fromPosition, rhs.toPosition);
+				});
+
+			//every collapse takes about two triangles along, don't go past the error of the collapses the target would need
+			//the cheap collapses the pass skips because their triangles are locked are done first in the next pass
+			const size_t nrNeededCollapses{ (nrTriangles - targetNrIndices / 3 + 1) / 2 };
+			const float errorLimit{ collapses.empty() ? 0.f : collapses[std::min(nrNeededCollapses, collapses.size() - 1)].error };
+
+			//Collapse as long as the target isn't reached, the triangles around a collapse are left alone for the rest of the pass
+			std::iota(vertexRemap.begin(), vertexRemap.end(), 0);
+			std::fill(isPositionLocked.begin(), isPositionLocked.end(), 0);
+
+			size_t nrRemainingTriangles{ nrTriangles };
+			bool hasCollapsed{ false };
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (nrRemainingTriangles * 3 <= targetNrIndices || collapse.error > errorLimit)
+					break;
+
+				if (isPositionLocked[collapse.fromPosition] || isPositionLocked[collapse.toPosition])
+					continue;
+
+				//every vertex at the from position has to move onto exactly one vertex at the to position & no two onto the same one,
+				//otherwise a uv or normal seam would get torn open or merged
+				wedgeRemap.clear();
+				bool isValid{ true };
+				size_t nrRemovedTriangles{};
+
+				for (uint32_t i{ triangleOffsets[collapse.fromPosition] }; i < triangleOffsets[collapse.fromPosition + 1] && isValid; ++i)
+				{
+					const uint32_t* pTriangle{ &result[static_cast<size_t>(positionTriangles[i]) * 3] };
+
+					int fromCorner{ -1 };
+					int toCorner{ -1 };
+					for (int corner{}; corner < 3; ++corner)
+					{
+						if (positionIds[pTriangle[corner]] == collapse.fromPosition) fromCorner = corner;
+						if (positionIds[pTriangle[corner]] == collapse.toPosition) toCorner = corner;
+					}
+
+					const uint32_t fromVertex{ pTriangle[fromCorner] };
+					const auto wedgeIt{ std::find_if(wedgeRemap.begin(), wedgeRemap.end(), [fromVertex](const auto& wedge) { return wedge.first == fromVertex; }) };
+
+					if (toCorner >= 0)
+					{
+						//this triangle disappears, it decides which vertex the from vertex moves onto
+						++nrRemovedTriangles;
+
+						const uint32_t toVertex{ pTriangle[toCorner] };
+						if (wedgeIt == wedgeRemap.end())
+						{
+							wedgeRemap.emplace_back(fromVertex, toVertex);
+						}
+						else if (wedgeIt->second == UINT32_MAX)
+						{
+							wedgeIt->second = toVertex;
+						}
+						else
+						{
+							isValid = wedgeIt->second == toVertex;
+						}
+						continue;
+					}
+
+					if (wedgeIt == wedgeRemap.end())
+					{
+						wedgeRemap.emplace_back(fromVertex, UINT32_MAX);
+					}
+
+					//this triangle stays, it can't flip or turn too far
+					const Vector3& P0{ positions[positionIds[pTriangle[0]]] };
+					const Vector3& P1{ positions[positionIds[pTriangle[1]]] };
+					const Vector3& P2{ positions[positionIds[pTriangle[2]]] };
+					const Vector3 oldNormal{ Vector3::Cross(P1 - P0, P2 - P0) };
+
+					Vector3 newPositions[3]{ P0, P1, P2 };
+					newPositions[fromCorner] = positions[collapse.toPosition];
+					const Vector3 newNormal{ Vector3::Cross(newPositions[1] - newPositions[0], newPositions[2] - newPositions[0]) };
+
+					isValid = Vector3::Dot(oldNormal, newNormal) > MinNormalDot * oldNormal.Magnitude() * newNormal.Magnitude();
+				}
+
+				for (size_t i{}; i < wedgeRemap.size() && isValid; ++i)
+				{
+					isValid = wedgeRemap[i].second != UINT32_MAX;
+					for (size_t j{}; j < i && isValid; ++j)
+					{
+						isValid = wedgeRemap[i].second != wedgeRemap[j].second;
+					}
+				}
+
+				if (!isValid || nrRemovedTriangles == 0)
+					continue;
+
+				for (const auto& [fromVertex, toVertex] : wedgeRemap)
+				{
+					vertexRemap[fromVertex] = toVertex;
+				}
+				quadrics[collapse.toPosition].Add(quadrics[collapse.fromPosition]);
+
+				for (uint32_t i{ triangleOffsets[collapse.fromPosition] }; i < triangleOffsets[collapse.fromPosition + 1]; ++i)
+				{
+					const uint32_t* pTriangle{ &result[static_cast<size_t>(positionTriangles[i]) * 3] };
+					for (int corner{}; corner < 3; ++corner)
+					{
+						isPositionLocked[positionIds[pTriangle[corner]]] = 1;
+					}
+				}
+
+				maxError = std::max(maxError, collapse.error);
+				nrRemainingTriangles -= nrRemovedTriangles;
+				hasCollapsed = true;
+			}
+
+			if (!hasCollapsed)
+				break;
+
+			//move the collapsed vertices & drop the triangles that lost their area, the order of the others is kept
+			size_t nrKeptIndices{};
+			for (size_t i{}; i < result.size(); i += 3)
+			{
+				const uint32_t triangle[3]{ vertexRemap[result[i]], vertexRemap[result[i + 1]], vertexRemap[result[i + 2]] };
+				if (isDegenerate(triangle))
+					continue;
+
+				std::copy(triangle, triangle + 3, result.begin() + nrKeptIndices);
+				nrKeptIndices += 3;
+			}
+			result.resize(nrKeptIndices);
+		}
+
+		if (pError)
+		{
+			*pError = maxError;
+		}
+
+		return result;
+	}
+}
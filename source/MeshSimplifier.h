@@ -0,0 +1,14 @@
+#pragma once
+
+namespace dae
+{
+	//Quadric error metric simplification (Garland & Heckbert 1997) by collapsing vertices onto one of their neighbours
+	//Only the triangle list changes, every level of detail keeps indexing the same vertices
+	namespace MeshSimplifier
+	{
+		//Collapses the cheapest edges until the list has no more than targetNrIndices indices or nothing can be collapsed anymore
+		//error is roughly the largest distance the surface moved, in object space & measured against the triangles passed in
+		//UV & normal seams only collapse along themselves and open borders along the border, so neither tears nor shrinks
+		std::vector<uint32_t> Simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetNrIndices, float* pError = nullptr);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "pch.h"
+#include <numeric>
+#include <tuple>
+
+//Connectivity the mesh passes (optimizer, simplifier & meshlet builder) share
+namespace dae::MeshUtils
+{
+	//Vertices split on uv or normal seams still share their position
+	//Gives every vertex the index of its position & returns the distinct positions, in sorted order
+	static std::vector<Vector3> WeldPositions(std::span<const Vertex> vertices, std::vector<uint32_t>& positionIds)
+	{
+		const size_t nrVertices{ vertices.size() };
+
+		const auto isLess{ [&](uint32_t lhs, uint32_t rhs)
+			{
+				const Vector3& lhsPosition{ vertices[lhs].position };
+				const Vector3& rhsPosition{ vertices[rhs].position };
+				return std::tie(lhsPosition.x, lhsPosition.y, lhsPosition.z) < std::tie(rhsPosition.x, rhsPosition.y, rhsPosition.z);
+			} };
+
+		std::vector<uint32_t> sortedVertices(nrVertices);
+		std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+		std::sort(sortedVertices.begin(), sortedVertices.end(), isLess);
+
+		std::vector<Vector3> positions{};
+		positionIds.resize(nrVertices);
+		for (size_t i{}; i < nrVertices; ++i)
+		{
+			if (i == 0 || isLess(sortedVertices[i - 1], sortedVertices[i]))
+				positions.push_back(vertices[sortedVertices[i]].position);
+
+			positionIds[sortedVertices[i]] = static_cast<uint32_t>(positions.size() - 1);
+		}
+		return positions;
+	}
+
+	//Triangles around every vertex as offsets into one array: the ones around key k are triangles[offsets[k]] up to triangles[offsets[k + 1]]
+	//keyOf maps a vertex index onto the key it gets listed under (itself, or its welded position), buffers get reused across calls
+	template<typename KeyOf>
+	static void BuildTriangleAdjacency(std::span<const uint32_t> indices, size_t nrKeys, const KeyOf& keyOf,
+		std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles)
+	{
+		offsets.assign(nrKeys + 1, 0);
+		for (const uint32_t vertexIdx : indices)
+		{
+			++offsets[keyOf(vertexIdx) + 1];
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		triangles.resize(indices.size());
+		std::vector<uint32_t> fillOffsets(offsets.begin(), offsets.end() - 1);
+		for (size_t cornerIdx{}; cornerIdx < indices.size(); ++cornerIdx)
+		{
+			triangles[fillOffsets[keyOf(indices[cornerIdx])]++] = static_cast<uint32_t>(cornerIdx / 3);
+		}
+	}
+}
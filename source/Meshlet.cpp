@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "Meshlet.h"
+#include "MeshUtils.h"
+
+namespace dae::MeshletBuilder
+{
+	//how many extra vertices a meshlet may take on to keep its triangles facing the same way, a tighter cone culls more often
+	//it only steers the growth, the vertex & triangle budget is what ends a meshlet
+	static constexpr float ConeWeight{ 4.f };
+	//a triangle facing away from the meshlet's average normal is never added, the cone could never cull the meshlet anymore
+	//any tighter & the meshlets split long before their budget runs out (at 60 degrees the vehicle averaged ~10 triangles per meshlet)
+	static constexpr float MinConeDot{ 0.f };
+
+
+	//unit normal following cross(V1 - V0, V2 - V0), zero for degenerate triangles
+	static Vector3 CalculateTriangleNormal(std::span<const Vertex> vertices, uint32_t V0Idx, uint32_t V1Idx, uint32_t V2Idx)
+	{
+		const Vector3& V0{ vertices[V0Idx].position };
+		const Vector3 normal{ Vector3::Cross(vertices[V1Idx].position - V0, vertices[V2Idx].position - V0) };
+
+		const float length{ normal.Magnitude() };
+		return (length > 0.f) ? normal / length : Vector3{};
+	}
+
+	static void CalculateMeshletBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const uint32_t> meshletVertices, Meshlet& meshlet)
+	{
+		//Sphere around the center of the bounding box, good enough for the handful of vertices a meshlet has
+		Vector3 minPosition{ vertices[meshletVertices[meshlet.firstVertex]].position };
+		Vector3 maxPosition{ minPosition };
+		for (uint32_t i{ 1 }; i < meshlet.nrVertices; ++i)
+		{
+			const Vector3& position{ vertices[meshletVertices[meshlet.firstVertex + i]].position };
+			minPosition = Vector3::Min(minPosition, position);
+			maxPosition = Vector3::Max(maxPosition, position);
+		}
+
+		meshlet.center = (minPosition + maxPosition) * 0.5f;
+		meshlet.radius = 0.f;
+		for (uint32_t i{}; i < meshlet.nrVertices; ++i)
+		{
+			const Vector3& position{ vertices[meshletVertices[meshlet.firstVertex + i]].position };
+			meshlet.radius = std::max(meshlet.radius, (position - meshlet.center).Magnitude());
+		}
+
+		//Normal cone, the axis is the average of the triangle normals & the cutoff comes from the normal furthest away from it
+		const size_t firstIndex{ static_cast<size_t>(meshlet.firstTriangle) * 3 };
+		const size_t lastIndex{ firstIndex + static_cast<size_t>(meshlet.nrTriangles) * 3 };
+
+		Vector3 normalSum{};
+		for (size_t i{ firstIndex }; i < lastIndex; i += 3)
+		{
+			normalSum += CalculateTriangleNormal(vertices, indices[i], indices[i + 1], indices[i + 2]);
+		}
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = Vector3::UnitZ;
+		meshlet.coneCutoff = 1.f;
+
+		const float axisLength{ normalSum.Magnitude() };
+		if (axisLength <= 0.f)
+			return;
+
+		const Vector3 axis{ normalSum / axisLength };
+
+		float minDot{ 1.f };
+		for (size_t i{ firstIndex }; i < lastIndex; i += 3)
+		{
+			const Vector3 normal{ CalculateTriangleNormal(vertices, indices[i], indices[i + 1], indices[i + 2]) };
+			if (normal.SqrMagnitude() > 0.f)
+				minDot = std::min(minDot, Vector3::Dot(axis, normal));
+		}
+
+		//cones wider than ~84 degrees would have their apex so far away that they almost never cull anything
+		if (minDot <= 0.1f)
+			return;
+
+		//move the apex back along the axis until it lies behind every triangle's plane
+		float maxDistance{};
+		for (size_t i{ firstIndex }; i < lastIndex; i += 3)
+		{
+			const Vector3 normal{ CalculateTriangleNormal(vertices, indices[i], indices[i + 1], indices[i + 2]) };
+			if (normal.SqrMagnitude() > 0.f)
+				maxDistance = std::max(maxDistance, Vector3::Dot(meshlet.center - vertices[indices[i]].position, normal) / Vector3::Dot(axis, normal));
+		}
+
+		meshlet.coneApex = meshlet.center - axis * maxDistance;
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+	}
+
+	std::vector<Meshlet> Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<uint32_t>& meshletIndices, std::vector<uint32_t>& meshletVertices,
+		uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		const uint32_t nrTriangles{ static_cast<uint32_t>(indices.size() / 3) };
+		const size_t nrVertices{ vertices.size() };
+
+		std::vector<Meshlet> meshlets{};
+		meshletIndices.clear();
+		meshletVertices.clear();
+		if (nrTriangles == 0)
+			return meshlets;
+
+		maxVertices = std::max(maxVertices, 3u);
+		maxTriangles = std::max(maxTriangles, 1u);
+
+		meshletIndices.reserve(static_cast<size_t>(nrTriangles) * 3);
+
+		//Vertices split on uv or normal seams still share their position, triangles are connected through positions instead
+		std::vector<uint32_t> positionIds{};
+		const size_t nrPositions{ MeshUtils::WeldPositions(vertices, positionIds).size() };
+
+		//Triangles around every position
+		std::vector<uint32_t> adjacencyOffsets{};
+		std::vector<uint32_t> adjacentTriangles{};
+		MeshUtils::BuildTriangleAdjacency(indices, nrPositions, [&](uint32_t vertexIdx) { return positionIds[vertexIdx]; }, adjacencyOffsets, adjacentTriangles);
+
+		std::vector<Vector3> triangleNormals(nrTriangles);
+		for (uint32_t triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+		{
+			const size_t idx{ static_cast<size_t>(triangleIdx) * 3 };
+			triangleNormals[triangleIdx] = CalculateTriangleNormal(vertices, indices[idx], indices[idx + 1], indices[idx + 2]);
+		}
+
+		//last meshlet every vertex got added to & every triangle got queued for, so nothing gets listed twice per meshlet
+		std::vector<uint32_t> vertexMeshlets(nrVertices, UINT32_MAX);
+		std::vector<uint32_t> candidateMeshlets(nrTriangles, UINT32_MAX);
+		std::vector<uint8_t> isEmitted(nrTriangles, 0);
+
+		std::vector<uint32_t> candidates{};
+		uint32_t seedTriangle{};
+
+		while (meshletIndices.size() < indices.size())
+		{
+			const uint32_t meshletIdx{ static_cast<uint32_t>(meshlets.size()) };
+
+			Meshlet meshlet{};
+			meshlet.firstTriangle = static_cast<uint32_t>(meshletIndices.size() / 3);
+			meshlet.firstVertex = static_cast<uint32_t>(meshletVertices.size());
+
+			Vector3 normalSum{};
+			candidates.clear();
+
+			while (meshlet.nrTriangles < maxTriangles)
+			{
+				uint32_t nextTriangle{ UINT32_MAX };
+
+				if (meshlet.nrTriangles == 0)
+				{
+					//seed every meshlet with the first triangle left in the original order, so the meshlets keep following it
+					while (isEmitted[seedTriangle])
+						++seedTriangle;
+
+					nextTriangle = seedTriangle;
+				}
+				else
+				{
+					//grow towards the neighbour that adds the fewest vertices & bends the normal cone the least
+					const float axisLength{ normalSum.Magnitude() };
+					const Vector3 axis{ (axisLength > 0.f) ? normalSum / axisLength : Vector3{} };
+
+					float bestScore{ FLT_MAX };
+					for (size_t i{}; i < candidates.size();)
+					{
+						const uint32_t triangleIdx{ candidates[i] };
+						if (isEmitted[triangleIdx])
+						{
+							candidates[i] = candidates.back();
+							candidates.pop_back();
+							continue;
+						}
+						++i;
+
+						const uint32_t* pTriangle{ &indices[static_cast<size_t>(triangleIdx) * 3] };
+						uint32_t nrNewVertices{};
+						for (int corner{}; corner < 3; ++corner)
+						{
+							nrNewVertices += (vertexMeshlets[pTriangle[corner]] != meshletIdx);
+						}
+
+						if (meshlet.nrVertices + nrNewVertices > maxVertices)
+							continue;
+
+						const float normalDot{ Vector3::Dot(triangleNormals[triangleIdx], axis) };
+						if (normalDot < MinConeDot)
+							continue;
+
+						const float score{ static_cast<float>(nrNewVertices) + ConeWeight * (1.f - normalDot) };
+						if (score < bestScore || (score == bestScore && triangleIdx < nextTriangle))
+						{
+							bestScore = score;
+							nextTriangle = triangleIdx;
+						}
+					}
+
+					//nothing connected fits anymore
+					if (nextTriangle == UINT32_MAX)
+						break;
+				}
+
+				//add the triangle & queue up its neighbours
+				isEmitted[nextTriangle] = 1;
+				normalSum += triangleNormals[nextTriangle];
+				++meshlet.nrTriangles;
+
+				for (int corner{}; corner < 3; ++corner)
+				{
+					const uint32_t vertexIdx{ indices[static_cast<size_t>(nextTriangle) * 3 + corner] };
+					meshletIndices.push_back(vertexIdx);
+
+					const uint32_t positionIdx{ positionIds[vertexIdx] };
+					for (uint32_t i{ adjacencyOffsets[positionIdx] }; i < adjacencyOffsets[positionIdx + 1]; ++i)
+					{
+						const uint32_t triangleIdx{ adjacentTriangles[i] };
+						if (isEmitted[triangleIdx] || candidateMeshlets[triangleIdx] == meshletIdx)
+							continue;
+
+						candidateMeshlets[triangleIdx] = meshletIdx;
+						candidates.push_back(triangleIdx);
+					}
+
+					if (vertexMeshlets[vertexIdx] == meshletIdx)
+						continue;
+
+					vertexMeshlets[vertexIdx] = meshletIdx;
+					meshletVertices.push_back(vertexIdx);
+					++meshlet.nrVertices;
+				}
+			}
+
+			CalculateMeshletBounds(vertices, meshletIndices, meshletVertices, meshlet);
+			meshlets.push_back(meshlet);
+		}
+
+		return meshlets;
+	}
+
+	bool IsOutsideFrustum(const Meshlet& meshlet, const Vector4 frustumPlanes[6])
+	{
+		for (int planeIdx{}; planeIdx < 6; ++planeIdx)
+		{
+			const Vector4& plane{ frustumPlanes[planeIdx] };
+			if (Vector3::Dot(plane.GetXYZ(), meshlet.center) + plane.w < -meshlet.radius)
+				return true;
+		}
+
+		return false;
+	}
+
+	bool IsBackFacing(const Meshlet& meshlet, const Vector3& cameraPos)
+	{
+		if (meshlet.coneCutoff >= 1.f)
+			return false;
+
+		//the camera sees the apex from inside the cone (mirrored), so it lies behind every triangle's plane
+		const Vector3 apexDirection{ meshlet.coneApex - cameraPos };
+		return Vector3::Dot(apexDirection, meshlet.coneAxis) >= meshlet.coneCutoff * apexDirection.Magnitude();
+	}
+}
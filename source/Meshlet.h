@@ -0,0 +1,39 @@
+#pragma once
+
+namespace dae
+{
+	//Small cluster of connected triangles facing roughly the same way, culled as a whole in object space
+	struct Meshlet
+	{
+		uint32_t firstTriangle{}; //into the meshlet index list, every meshlet owns a consecutive range of triangles
+		uint32_t nrTriangles{};
+		uint32_t firstVertex{}; //into the meshlet vertex list, every vertex the triangles use once
+		uint32_t nrVertices{};
+
+		//bounding sphere
+		Vector3 center{};
+		float radius{};
+
+		//normal cone, every triangle faces away from a camera inside the cone behind the apex (Meshoptimizer's formulation)
+		//cutoff is the sine of the cone's half angle, 1 (or more) means the triangles spread too much for the cone to ever cull
+		Vector3 coneApex{};
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	namespace MeshletBuilder
+	{
+		constexpr uint32_t MaxVertices{ 64 };
+		constexpr uint32_t MaxTriangles{ 124 };
+
+		//Grows meshlets over the triangle list's adjacency & writes the triangles out again grouped per meshlet in meshletIndices
+		//Every meshlet starts at the first triangle left in the original order, so the order the optimizer picked is roughly kept
+		std::vector<Meshlet> Build(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<uint32_t>& meshletIndices, std::vector<uint32_t>& meshletVertices,
+			uint32_t maxVertices = MaxVertices, uint32_t maxTriangles = MaxTriangles);
+
+		//Object space tests, frustumPlanes are (normal, distance) with the normal pointing inside & normalized
+		bool IsOutsideFrustum(const Meshlet& meshlet, const Vector4 frustumPlanes[6]);
+		//Geometric normals follow cross(V1 - V0, V2 - V0), a triangle faces away when the camera lies on the negative side of its plane
+		bool IsBackFacing(const Meshlet& meshlet, const Vector3& cameraPos);
+	}
+}
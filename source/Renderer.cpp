@@ -3,7 +3,8 @@
 #include "Camera.h"
 #include "Mesh.h"
 #include "Texture.h"
-#include "Utils.h"
+#include "ThreadPool.h"
+#include "MeshData.h"
 
 namespace dae
 {
@@ -20,6 +21,12 @@ namespace dae
 		m_pBackBufferPixels = static_cast<uint32_t*>(m_pBackBuffer->pixels);
 
 		m_pDepthBufferPixels = new float[static_cast<unsigned long long>(m_Width * m_Height)];
+		m_NrHiZBlocks = { (m_Width + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE, (m_Height + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE };
+		m_pHiZBufferPixels = new float[static_cast<unsigned long long>(m_NrHiZBlocks.x * m_NrHiZBlocks.y)];
+		m_pTriangleIdBufferPixels = new uint32_t[static_cast<unsigned long long>(m_Width * m_Height)];
+
+		//Create worker threads for the software rasterizer
+		m_pThreadPool = new ThreadPool{ m_NrThreads };
 		
 		//Initialize DirectX pipeline
 		if (InitializeDirectX() == S_OK)
@@ -42,16 +49,17 @@ namespace dae
 		m_pVehicle = InitializeMesh("Resources/vehicle.obj", EffectType::STANDARD, L"Resources/vehicle.fx");
 		m_pVehicle->InitializeTransform(translation);
 
-		m_pVehicle->SetDiffuseMap(Texture::LoadFromFile("Resources/vehicle_diffuse.png", m_pDevice));
-		m_pVehicle->SetNormalMap(Texture::LoadFromFile("Resources/vehicle_normal.png", m_pDevice));
-		m_pVehicle->SetSpecularMap(Texture::LoadFromFile("Resources/vehicle_specular.png", m_pDevice));
-		m_pVehicle->SetGlossinessMap(Texture::LoadFromFile("Resources/vehicle_gloss.png", m_pDevice));
+		//the software sampler walks the maps in every direction as the vehicle turns, tiles keep that within a few cache lines
+		m_pVehicle->SetDiffuseMap(Texture::LoadFromFile("Resources/vehicle_diffuse.png", m_pDevice, TexelLayout::MATERIAL, TexelOrder::TILED));
+		m_pVehicle->SetNormalMap(Texture::LoadFromFile("Resources/vehicle_normal.png", m_pDevice, TexelLayout::MATERIAL, TexelOrder::TILED));
+		m_pVehicle->SetSpecularMap(Texture::LoadFromFile("Resources/vehicle_specular.png", m_pDevice, TexelLayout::MATERIAL, TexelOrder::TILED));
+		m_pVehicle->SetGlossinessMap(Texture::LoadFromFile("Resources/vehicle_gloss.png", m_pDevice, TexelLayout::MATERIAL, TexelOrder::TILED));
 
 		//Initialize fireFX mesh, transform and textures
 		m_pFireFX = InitializeMesh("Resources/fireFX.obj", EffectType::TRANSPARENCY, L"Resources/fireFX.fx");
 		m_pFireFX->InitializeTransform(translation);
 		
-		m_pFireFX->SetDiffuseMap(Texture::LoadFromFile("Resources/fireFX_diffuse.png", m_pDevice));
+		m_pFireFX->SetDiffuseMap(Texture::LoadFromFile("Resources/fireFX_diffuse.png", m_pDevice, TexelLayout::MATERIAL, TexelOrder::TILED));
 
 		//Create Sampler State
 		InitializeSamplerState();
@@ -81,6 +89,9 @@ namespace dae
 		if (m_pDevice) m_pDevice->Release();
 
 		//Software
+		delete m_pThreadPool;
+		delete[] m_pTriangleIdBufferPixels;
+		delete[] m_pHiZBufferPixels;
 		delete[] m_pDepthBufferPixels;
 
 		//Shared
@@ -100,6 +111,9 @@ namespace dae
 			m_pFireFX->RotateY(m_MeshRotateSpeed * pTimer->GetElapsed());
 		}
 
+		//Pick the level of detail both paths draw this frame
+		m_pVehicle->UpdateLod(m_pCamera->GetViewMatrix(), m_pCamera->GetProjectionMatrix(), m_Height);
+
 		//Handle Updating Matrices
 		m_pVehicle->UpdateMatrices(m_pCamera->GetViewMatrix(), m_pCamera->GetProjectionMatrix(), m_pCamera->GetInvViewMatrix());
 		
@@ -109,7 +123,7 @@ namespace dae
 		}
 		else //Transform Vertices - Software Only
 		{
-			m_pVehicle->VertexTransformationFunction(m_Width, m_Height, m_pCamera->GetViewMatrix(), m_pCamera->GetProjectionMatrix(), m_pCamera->GetPosition());
+			m_pVehicle->VertexTransformationFunction(m_Width, m_Height, m_pCamera->GetViewMatrix(), m_pCamera->GetProjectionMatrix(), m_pCamera->GetPosition(), m_pThreadPool, m_NrThreads, m_VertexChunkSize, m_IsTransformingLazily);
 		}
 	}
 
@@ -169,16 +183,27 @@ namespace dae
 			m_pBackBuffer,
 			m_pBackBufferPixels,
 			m_pDepthBufferPixels,
+			m_pHiZBufferPixels,
+			m_pTriangleIdBufferPixels,
 			m_ShadingMode,
 			m_IsUsingNormalMap,
 		};
 
+		//Set Tiling & Threading Info
+		SRInfo.pThreadPool = m_pThreadPool;
+		SRInfo.tileSize = m_TileSize;
+		SRInfo.nrThreads = m_NrThreads;
+
 		//Set Software Rendering State
 		if (m_ShouldShowBoundingBox) { SRInfo.SRState = SoftwareRenderingState::BOUNDING_BOXES; }
 		else if (m_ShouldShowDepthBuffer) { SRInfo.SRState = SoftwareRenderingState::DEPTH_BUFFER; }
+		SRInfo.isUsingVisibilityBuffer = m_IsUsingVisibilityBuffer;
 
 		m_pVehicle->RenderSoftware(SRInfo);
 
+		//Keep this frame's statistics around for printing
+		m_SoftwareRenderingStats = SRInfo.stats;
+
 		//Update SDL Surface
 		SDL_UnlockSurface(m_pBackBuffer);
 		SDL_BlitSurface(m_pBackBuffer, nullptr, m_pFrontBuffer, nullptr);
@@ -189,16 +214,69 @@ namespace dae
 	{
 		Mesh* pMesh{};
 
-		std::vector<Vertex> vertices{};
-		std::vector<uint32_t> indices{};
-
-		if (!Utils::ParseOBJ(filename, vertices, indices))
+		//Report every tenth of a streaming stage, only huge OBJs get streamed so those take a while
+		MeshStreamingSettings streamingSettings{};
+		streamingSettings.memoryBudget = m_MeshMemoryBudget;
+		streamingSettings.progressCallback = [&filename, lastStage = MeshStreamingStage::PARSING, lastStep = -1](MeshStreamingStage stage, float progress) mutable
+			{
+				const int step{ static_cast<int>(progress * 10.f) };
+				if (stage == lastStage && step == lastStep)
+					return;
+
+				lastStage = stage;
+				lastStep = step;
+
+				static constexpr const char* stageNames[]{ "parsing", "welding", "tangents" };
+				std::cout << filename << ": streaming, " << stageNames[static_cast<int>(stage)] << " " << step * 10 << "%\n";
+			};
+
+		//Transparent meshes blend in triangle order, so only opaque ones get their triangles reordered
+		const MeshOptimizationSettings optimizationSettings{};
+		const bool isOptimizing{ m_IsOptimizingMeshes && effectType == EffectType::STANDARD };
+
+		MeshLoadStats loadStats{};
+		MeshData* pMeshData{ MeshData::LoadOBJ(filename, true, m_pThreadPool, &loadStats, &streamingSettings, isOptimizing ? &optimizationSettings : nullptr) };
+		if (!pMeshData)
 		{
 			std::cout << "Failed to parseObj!";
 			return pMesh;
 		}
 
-		pMesh = new Mesh{ m_pDevice, effectType, effectFilename, std::move(vertices), std::move(indices) };
+#if defined(DEBUG) || defined(_DEBUG)
+		//Load report, how long every step took & what the optimizer made of the mesh
+		if (loadStats.isFromCache)
+		{
+			std::cout << filename << ": mapped " << pMeshData->GetVertices().size() << " vertices & " << pMeshData->GetIndices().size() << " indices from " << MeshData::GetCachePath(filename) << " in " << loadStats.loadMilliseconds << "ms\n";
+		}
+		else
+		{
+			const Utils::OBJParseStats& parseStats{ loadStats.parseStats };
+			std::cout << filename << ": welded " << parseStats.nrFaceCorners << " face corners into " << parseStats.nrVertices << " vertices ("
+				<< static_cast<float>(parseStats.nrFaceCorners) / static_cast<float>(std::max<size_t>(parseStats.nrVertices, 1)) << "x fewer), parsed in " << parseStats.parseMilliseconds << "ms, welded in " << parseStats.weldMilliseconds << "ms, tangents in " << parseStats.tangentMilliseconds << "ms, "
+				<< (loadStats.isCacheWritten ? "cached" : "not cached") << " after " << loadStats.loadMilliseconds << "ms\n";
+
+			if (loadStats.isStreamed)
+			{
+				std::cout << filename << ": streamed in " << loadStats.nrStreamingPasses << " passes, peaking at " << loadStats.peakStreamingBytes / (1 << 20) << "MB of " << m_MeshMemoryBudget / (1 << 20) << "MB\n";
+			}
+		}
+
+		if (loadStats.isOptimized)
+		{
+			const MeshOptimizationStats& optimizationStats{ loadStats.optimizationStats };
+			std::cout << filename << ": optimized ACMR " << optimizationStats.before.ACMR << " -> " << optimizationStats.after.ACMR
+				<< ", ATVR " << optimizationStats.before.ATVR << " -> " << optimizationStats.after.ATVR << " (cache of " << optimizationSettings.cacheSize << ") in " << optimizationStats.milliseconds << "ms\n";
+			std::cout << filename << ": " << pMeshData->GetMeshlets().size() << " meshlets of up to " << MeshletBuilder::MaxVertices << " vertices & " << MeshletBuilder::MaxTriangles << " triangles\n";
+
+			for (size_t lodIdx{}; lodIdx < pMeshData->GetLods().size(); ++lodIdx)
+			{
+				const MeshLod& lod{ pMeshData->GetLods()[lodIdx] };
+				std::cout << filename << ": LOD " << lodIdx << " has " << lod.nrIndices / 3 << " triangles in " << lod.nrMeshlets << " meshlets, error " << lod.error << "\n";
+			}
+		}
+#endif
+
+		pMesh = new Mesh{ m_pDevice, effectType, effectFilename, pMeshData };
 
 		return pMesh;
 	}
@@ -266,6 +344,11 @@ namespace dae
 	{
 		const int nrPixels{ m_Width * m_Height };
 		std::fill_n(m_pDepthBufferPixels, nrPixels, FLT_MAX);
+
+		const int nrHiZBlocks{ m_NrHiZBlocks.x * m_NrHiZBlocks.y };
+		std::fill_n(m_pHiZBufferPixels, nrHiZBlocks, FLT_MAX);
+
+		std::fill_n(m_pTriangleIdBufferPixels, nrPixels, INVALID_TRIANGLE_ID);
 	}
 #pragma endregion
 
@@ -422,6 +505,11 @@ namespace dae
 
 		m_pVehicle->SetSampler(m_pSamplerState);
 		m_pFireFX->SetSampler(m_pSamplerState);
+
+		//the software sampler filters the same way, wrapping like the hardware one
+		const SoftwareSampler softwareSampler{ m_SamplerState, TextureAddressMode::WRAP, static_cast<int>(m_SamplerDesc.MaxAnisotropy) };
+		m_pVehicle->SetSampler(softwareSampler);
+		m_pFireFX->SetSampler(softwareSampler);
 	}
 #pragma endregion
 
@@ -468,6 +556,20 @@ namespace dae
 		SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
 		std::cout << "**(SOFTWARE) BoundingBox Visualization = " << (m_ShouldShowBoundingBox ? "ON" : "OFF") << "\n";
 	}
+	void Renderer::ToggleIsUsingVisibilityBuffer()
+	{
+		m_IsUsingVisibilityBuffer = !m_IsUsingVisibilityBuffer;
+
+		SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+		std::cout << "**(SOFTWARE) Visibility Buffer = " << (m_IsUsingVisibilityBuffer ? "ON" : "OFF") << "\n";
+	}
+	void Renderer::ToggleIsTransformingLazily()
+	{
+		m_IsTransformingLazily = !m_IsTransformingLazily;
+
+		SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+		std::cout << "**(SOFTWARE) Lazy Vertex Transform = " << (m_IsTransformingLazily ? "ON" : "OFF") << "\n";
+	}
 	void Renderer::ToggleIsUsingUniformClearColor()
 	{
 		m_IsUsingUniformClearColor = !m_IsUsingUniformClearColor;
@@ -487,8 +589,8 @@ namespace dae
 	{
 		m_SamplerState = static_cast<SamplerState>((static_cast<int>(m_SamplerState) + 1) % (static_cast<int>(SamplerState::ANISOTROPIC) + 1));
 
-		SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-		std::cout << "**(HARDWARE) Sampler State = ";
+		SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+		std::cout << "**(SHARED) Sampler State = ";
 		switch (m_SamplerState)
 		{
 		case SamplerState::POINT:
@@ -561,6 +663,21 @@ namespace dae
 	{
 		SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
 		std::cout << "dFPS: " << fps << "\n";
+		std::cout << "  LOD: " << m_pVehicle->GetLodIdx() << " of " << m_pVehicle->GetNrLods() << "\n";
+
+		if (!m_IsUsingDirectX)
+		{
+			std::cout << "  HiZ rejected: " << m_SoftwareRenderingStats.nrHiZRejectedTriangles << " triangles, "
+				<< m_SoftwareRenderingStats.nrHiZRejectedBlocks << " blocks\n";
+			std::cout << "  Triangles: " << m_SoftwareRenderingStats.nrAcceptedTriangles << " accepted, "
+				<< m_SoftwareRenderingStats.nrClippedTriangles << " clipped, "
+				<< m_SoftwareRenderingStats.nrCulledTriangles << " culled\n";
+			std::cout << "  Meshlets: " << m_SoftwareRenderingStats.nrCulledMeshlets << " of " << m_SoftwareRenderingStats.nrMeshlets << " culled ("
+				<< m_SoftwareRenderingStats.nrMeshletCulledTriangles << " triangles)\n";
+			std::cout << "  Vertices: " << m_SoftwareRenderingStats.nrTransformedPositions << " positions & " << m_SoftwareRenderingStats.nrTransformedAttributes << " attributes transformed of "
+				<< m_SoftwareRenderingStats.nrVertices << "\n";
+			std::cout << "  Shaded pixels: " << m_SoftwareRenderingStats.nrShadedPixels << "\n";
+		}
 	}
 	void Renderer::PrintControls() const
 	{
@@ -636,6 +753,43 @@ namespace dae
 		}
 		std::cout << ")\n";
 
+		std::cout << "  [F4]\tCycle Sampler State (";
+		switch (m_SamplerState)
+		{
+		case SamplerState::POINT:
+			std::cout << "POINT/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "LINEAR";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			std::cout << "/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "ANISOTROPIC";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			break;
+
+		case SamplerState::LINEAR:
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "POINT";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			std::cout << "/LINEAR/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "ANISOTROPIC";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			break;
+
+		case SamplerState::ANISOTROPIC:
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "POINT";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			std::cout << "/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "LINEAR";
+			SetConsoleTextAttribute(m_hConsole, m_SharedColor);
+			std::cout << "/ANISOTROPIC";
+			break;
+		}
+		std::cout << ")\n";
+
 		std::cout << "  [F9]\tCycle CullMode (";
 		switch (m_CullMode)
 		{
@@ -727,43 +881,6 @@ namespace dae
 			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
 			std::cout << "/OFF";
 		}
-		std::cout << ")\n";
-
-		std::cout << "  [F4]\tCycle Sampler State (";
-		switch (m_SamplerState)
-		{
-		case SamplerState::POINT:
-			std::cout << "POINT/";
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "LINEAR";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			std::cout << "/";
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "ANISOTROPIC";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			break;
-
-		case SamplerState::LINEAR:
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "POINT";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			std::cout << "/LINEAR/";
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "ANISOTROPIC";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			break;
-
-		case SamplerState::ANISOTROPIC:
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "POINT/";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			std::cout << "/";
-			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
-			std::cout << "LINEAR";
-			SetConsoleTextAttribute(m_hConsole, m_HardwareColor);
-			std::cout << "/ANISOTROPIC";
-			break;
-		}
 		std::cout << ")\n\n";
 
 		//Software settings
@@ -882,6 +999,40 @@ namespace dae
 			SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
 			std::cout << "/OFF";
 		}
+		std::cout << ")\n";
+
+		std::cout << "  [V]\tToggle Visibility Buffer (";
+		if (m_IsUsingVisibilityBuffer)
+		{
+			std::cout << "ON/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "OFF";
+			SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+		}
+		else
+		{
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "ON";
+			SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+			std::cout << "/OFF";
+		}
+		std::cout << ")\n";
+
+		std::cout << "  [L]\tToggle Lazy Vertex Transform (";
+		if (m_IsTransformingLazily)
+		{
+			std::cout << "ON/";
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "OFF";
+			SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+		}
+		else
+		{
+			SetConsoleTextAttribute(m_hConsole, m_DefaultColor);
+			std::cout << "ON";
+			SetConsoleTextAttribute(m_hConsole, m_SoftwareColor);
+			std::cout << "/OFF";
+		}
 		std::cout << ")\n\n";
 
 		//Extra settings
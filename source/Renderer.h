@@ -8,6 +8,7 @@ namespace dae
 	class Camera;
 	class Mesh;
 	class Texture;
+	class ThreadPool;
 
 	class Renderer final
 	{
@@ -34,6 +35,8 @@ namespace dae
 		void ToggleIsUsingNormalMap(); //F6
 		void ToggleShouldShowDepthBuffer(); //F7
 		void ToggleShouldShowBoundingBox(); //F8
+		void ToggleIsUsingVisibilityBuffer(); //V
+		void ToggleIsTransformingLazily(); //L
 		void ToggleIsUsingUniformClearColor(); //F10
 		void ToggleShouldPrintFPS(); //F11
 
@@ -81,6 +84,8 @@ namespace dae
 		bool m_IsUsingNormalMap{ true }; //F6
 		bool m_ShouldShowDepthBuffer{ false }; //F7
 		bool m_ShouldShowBoundingBox{ false }; //F8
+		bool m_IsUsingVisibilityBuffer{ false }; //V
+		bool m_IsTransformingLazily{ false }; //L
 		bool m_IsUsingUniformClearColor{ false }; //F10
 		bool m_ShouldPrintFPS{ true }; //F11
 
@@ -106,6 +111,18 @@ namespace dae
 		uint32_t* m_pBackBufferPixels{};
 
 		float* m_pDepthBufferPixels{};
+		float* m_pHiZBufferPixels{};
+		uint32_t* m_pTriangleIdBufferPixels{};
+		Int2 m_NrHiZBlocks{};
+
+		mutable SoftwareRenderingStats m_SoftwareRenderingStats{};
+
+		ThreadPool* m_pThreadPool{};
+		const int m_TileSize{ 64 };
+		const uint32_t m_VertexChunkSize{ 4096 }; //vertices transformed per job
+		const uint32_t m_NrThreads{ std::max(std::thread::hardware_concurrency(), 1u) };
+		const size_t m_MeshMemoryBudget{ size_t{ 1 } << 30 }; //OBJs that don't fit are streamed into their mesh cache out of core
+		const bool m_IsOptimizingMeshes{ true }; //reorder triangles & vertices for the post transform cache & overdraw before caching
 
 		void ClearBackground() const;
 		void ResetDepthBuffer() const;
@@ -0,0 +1,325 @@
+#pragma once
+
+//Pick the widest instruction set the build targets, define RASTERIZER_NO_SIMD to force the scalar fallback
+#if !defined(RASTERIZER_NO_SIMD) && defined(__AVX2__)
+#define RASTERIZER_SIMD_AVX2
+#include <immintrin.h>
+#elif !defined(RASTERIZER_NO_SIMD) && (defined(_M_X64) || defined(__SSE2__))
+#define RASTERIZER_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <bit>
+#include <cmath>
+
+namespace dae::SIMD
+{
+	//Thin wrappers around the registers so the raster kernel is written once for every lane count:
+	//FloatN holds Width floats, IntN holds Width 32-bit integers, Int64N holds Width 64-bit integers (split over two registers when SIMD is enabled)
+	//Lane masks are plain bit masks (bit i = lane i) as returned by MoveMask & SignMask
+
+#if defined(RASTERIZER_SIMD_AVX2)
+	constexpr int Width{ 8 };
+
+	struct FloatN { __m256 v; };
+	struct IntN { __m256i v; };
+	struct Int64N { __m256i lo; __m256i hi; };
+
+	inline FloatN Set1(const float f) { return { _mm256_set1_ps(f) }; }
+	inline FloatN LaneIndex() { return { _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) }; }
+	inline FloatN Load(const float* pData) { return { _mm256_loadu_ps(pData) }; }
+	inline void Store(float* pData, const FloatN& a) { _mm256_storeu_ps(pData, a.v); }
+
+	inline FloatN operator+(const FloatN& a, const FloatN& b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline FloatN operator-(const FloatN& a, const FloatN& b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline FloatN operator-(const FloatN& a) { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)) }; }
+	inline FloatN operator*(const FloatN& a, const FloatN& b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline FloatN operator/(const FloatN& a, const FloatN& b) { return { _mm256_div_ps(a.v, b.v) }; }
+	inline FloatN Sqrt(const FloatN& a) { return { _mm256_sqrt_ps(a.v) }; }
+	inline FloatN Min(const FloatN& a, const FloatN& b) { return { _mm256_min_ps(a.v, b.v) }; }
+	inline FloatN Max(const FloatN& a, const FloatN& b) { return { _mm256_max_ps(a.v, b.v) }; }
+
+	//!(a < b), true when either one is NaN just like the scalar comparison
+	inline FloatN NotLess(const FloatN& a, const FloatN& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_NLT_UQ) }; }
+	inline FloatN Less(const FloatN& a, const FloatN& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline uint32_t MoveMask(const FloatN& mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask.v)); }
+	inline FloatN MaskFromBits(const uint32_t bits)
+	{
+		const __m256i laneBits{ _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128) };
+		const __m256i selected{ _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), laneBits) };
+		return { _mm256_castsi256_ps(_mm256_cmpeq_epi32(selected, laneBits)) };
+	}
+	inline FloatN Select(const FloatN& mask, const FloatN& a, const FloatN& b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+	inline IntN Set1(const int32_t i) { return { _mm256_set1_epi32(i) }; }
+	inline void Store(int32_t* pData, const IntN& a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pData), a.v); }
+	inline IntN TruncateToInt(const FloatN& a) { return { _mm256_cvttps_epi32(a.v) }; }
+	inline IntN RoundToInt(const FloatN& a) { return { _mm256_cvtps_epi32(a.v) }; }
+	inline FloatN ToFloat(const IntN& a) { return { _mm256_cvtepi32_ps(a.v) }; }
+	inline IntN AsInt(const FloatN& a) { return { _mm256_castps_si256(a.v) }; }
+	inline FloatN AsFloat(const IntN& a) { return { _mm256_castsi256_ps(a.v) }; }
+
+	inline IntN operator+(const IntN& a, const IntN& b) { return { _mm256_add_epi32(a.v, b.v) }; }
+	inline IntN operator-(const IntN& a, const IntN& b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+	inline IntN operator&(const IntN& a, const IntN& b) { return { _mm256_and_si256(a.v, b.v) }; }
+	inline IntN operator|(const IntN& a, const IntN& b) { return { _mm256_or_si256(a.v, b.v) }; }
+	inline IntN operator*(const IntN& a, const IntN& b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+	inline IntN ShiftLeft(const IntN& a, const int count) { return { _mm256_sll_epi32(a.v, _mm_cvtsi32_si128(count)) }; }
+	inline IntN ShiftRight(const IntN& a, const int count) { return { _mm256_srl_epi32(a.v, _mm_cvtsi32_si128(count)) }; }
+
+	//Fetches pData[y * rowLength + x] for the lanes in laneMask, the other lanes are never read and return 0
+	inline IntN Gather(const uint32_t* pData, const IntN& x, const IntN& y, const int rowLength, const uint32_t laneMask)
+	{
+		const __m256i index{ _mm256_add_epi32(_mm256_mullo_epi32(y.v, _mm256_set1_epi32(rowLength)), x.v) };
+		return { _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(pData), index, _mm256_castps_si256(MaskFromBits(laneMask).v), 4) };
+	}
+
+	inline Int64N Ramp(const int64_t start, const int64_t step)
+	{
+		const __m256i lo{ _mm256_setr_epi64x(start, start + step, start + 2 * step, start + 3 * step) };
+		return { lo, _mm256_add_epi64(lo, _mm256_set1_epi64x(4 * step)) };
+	}
+	inline Int64N Set1(const int64_t i) { const __m256i v{ _mm256_set1_epi64x(i) }; return { v, v }; }
+	inline Int64N operator+(const Int64N& a, const Int64N& b) { return { _mm256_add_epi64(a.lo, b.lo), _mm256_add_epi64(a.hi, b.hi) }; }
+	inline Int64N operator|(const Int64N& a, const Int64N& b) { return { _mm256_or_si256(a.lo, b.lo), _mm256_or_si256(a.hi, b.hi) }; }
+	inline uint32_t SignMask(const Int64N& a)
+	{
+		return static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(a.lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(a.hi)) << 4));
+	}
+
+#elif defined(RASTERIZER_SIMD_SSE2)
+	constexpr int Width{ 4 };
+
+	struct FloatN { __m128 v; };
+	struct IntN { __m128i v; };
+	struct Int64N { __m128i lo; __m128i hi; };
+
+	inline FloatN Set1(const float f) { return { _mm_set1_ps(f) }; }
+	inline FloatN LaneIndex() { return { _mm_setr_ps(0.f, 1.f, 2.f, 3.f) }; }
+	inline FloatN Load(const float* pData) { return { _mm_loadu_ps(pData) }; }
+	inline void Store(float* pData, const FloatN& a) { _mm_storeu_ps(pData, a.v); }
+
+	inline FloatN operator+(const FloatN& a, const FloatN& b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline FloatN operator-(const FloatN& a, const FloatN& b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline FloatN operator-(const FloatN& a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.f)) }; }
+	inline FloatN operator*(const FloatN& a, const FloatN& b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline FloatN operator/(const FloatN& a, const FloatN& b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline FloatN Sqrt(const FloatN& a) { return { _mm_sqrt_ps(a.v) }; }
+	inline FloatN Min(const FloatN& a, const FloatN& b) { return { _mm_min_ps(a.v, b.v) }; }
+	inline FloatN Max(const FloatN& a, const FloatN& b) { return { _mm_max_ps(a.v, b.v) }; }
+
+	//!(a < b), true when either one is NaN just like the scalar comparison
+	inline FloatN NotLess(const FloatN& a, const FloatN& b) { return { _mm_cmpnlt_ps(a.v, b.v) }; }
+	inline FloatN Less(const FloatN& a, const FloatN& b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	inline uint32_t MoveMask(const FloatN& mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask.v)); }
+	inline FloatN MaskFromBits(const uint32_t bits)
+	{
+		const __m128i laneBits{ _mm_setr_epi32(1, 2, 4, 8) };
+		const __m128i selected{ _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), laneBits) };
+		return { _mm_castsi128_ps(_mm_cmpeq_epi32(selected, laneBits)) };
+	}
+	inline FloatN Select(const FloatN& mask, const FloatN& a, const FloatN& b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+
+	inline IntN Set1(const int32_t i) { return { _mm_set1_epi32(i) }; }
+	inline void Store(int32_t* pData, const IntN& a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pData), a.v); }
+	inline IntN TruncateToInt(const FloatN& a) { return { _mm_cvttps_epi32(a.v) }; }
+	inline IntN RoundToInt(const FloatN& a) { return { _mm_cvtps_epi32(a.v) }; }
+	inline FloatN ToFloat(const IntN& a) { return { _mm_cvtepi32_ps(a.v) }; }
+	inline IntN AsInt(const FloatN& a) { return { _mm_castps_si128(a.v) }; }
+	inline FloatN AsFloat(const IntN& a) { return { _mm_castsi128_ps(a.v) }; }
+
+	inline IntN operator+(const IntN& a, const IntN& b) { return { _mm_add_epi32(a.v, b.v) }; }
+	inline IntN operator-(const IntN& a, const IntN& b) { return { _mm_sub_epi32(a.v, b.v) }; }
+	inline IntN operator&(const IntN& a, const IntN& b) { return { _mm_and_si128(a.v, b.v) }; }
+	inline IntN operator|(const IntN& a, const IntN& b) { return { _mm_or_si128(a.v, b.v) }; }
+	//SSE2 only multiplies the even lanes into 64 bits, so the odd lanes get shifted down & both halves are put back together
+	inline IntN operator*(const IntN& a, const IntN& b)
+	{
+		const __m128i even{ _mm_mul_epu32(a.v, b.v) };
+		const __m128i odd{ _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32)) };
+		return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+	}
+	inline IntN ShiftLeft(const IntN& a, const int count) { return { _mm_sll_epi32(a.v, _mm_cvtsi32_si128(count)) }; }
+	inline IntN ShiftRight(const IntN& a, const int count) { return { _mm_srl_epi32(a.v, _mm_cvtsi32_si128(count)) }; }
+
+	//Fetches pData[y * rowLength + x] for the lanes in laneMask, the other lanes are never read and return 0
+	//SSE2 has no gather instruction, so the lanes are fetched one by one
+	inline IntN Gather(const uint32_t* pData, const IntN& x, const IntN& y, const int rowLength, const uint32_t laneMask)
+	{
+		alignas(16) int32_t xs[Width]{};
+		alignas(16) int32_t ys[Width]{};
+		alignas(16) uint32_t values[Width]{};
+		_mm_store_si128(reinterpret_cast<__m128i*>(xs), x.v);
+		_mm_store_si128(reinterpret_cast<__m128i*>(ys), y.v);
+
+		for (uint32_t remainingMask{ laneMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
+		{
+			const int lane{ std::countr_zero(remainingMask) };
+			values[lane] = pData[ys[lane] * rowLength + xs[lane]];
+		}
+		return { _mm_load_si128(reinterpret_cast<const __m128i*>(values)) };
+	}
+
+	inline Int64N Ramp(const int64_t start, const int64_t step)
+	{
+		const __m128i lo{ _mm_set_epi64x(start + step, start) };
+		return { lo, _mm_add_epi64(lo, _mm_set1_epi64x(2 * step)) };
+	}
+	inline Int64N Set1(const int64_t i) { const __m128i v{ _mm_set1_epi64x(i) }; return { v, v }; }
+	inline Int64N operator+(const Int64N& a, const Int64N& b) { return { _mm_add_epi64(a.lo, b.lo), _mm_add_epi64(a.hi, b.hi) }; }
+	inline Int64N operator|(const Int64N& a, const Int64N& b) { return { _mm_or_si128(a.lo, b.lo), _mm_or_si128(a.hi, b.hi) }; }
+	inline uint32_t SignMask(const Int64N& a)
+	{
+		return static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(a.lo)) | (_mm_movemask_pd(_mm_castsi128_pd(a.hi)) << 2));
+	}
+
+#else
+	constexpr int Width{ 1 };
+
+	struct FloatN { float v; };
+	struct IntN { int32_t v; };
+	struct Int64N { int64_t v; };
+
+	inline FloatN Set1(const float f) { return { f }; }
+	inline FloatN LaneIndex() { return { 0.f }; }
+	inline FloatN Load(const float* pData) { return { *pData }; }
+	inline void Store(float* pData, const FloatN& a) { *pData = a.v; }
+
+	inline FloatN operator+(const FloatN& a, const FloatN& b) { return { a.v + b.v }; }
+	inline FloatN operator-(const FloatN& a, const FloatN& b) { return { a.v - b.v }; }
+	inline FloatN operator-(const FloatN& a) { return { -a.v }; }
+	inline FloatN operator*(const FloatN& a, const FloatN& b) { return { a.v * b.v }; }
+	inline FloatN operator/(const FloatN& a, const FloatN& b) { return { a.v / b.v }; }
+	inline FloatN Sqrt(const FloatN& a) { return { sqrtf(a.v) }; }
+	inline FloatN Min(const FloatN& a, const FloatN& b) { return { (a.v < b.v) ? a.v : b.v }; }
+	inline FloatN Max(const FloatN& a, const FloatN& b) { return { (a.v > b.v) ? a.v : b.v }; }
+
+	inline FloatN NotLess(const FloatN& a, const FloatN& b) { return { std::bit_cast<float>(!(a.v < b.v) ? 0xFFFFFFFFu : 0u) }; }
+	inline FloatN Less(const FloatN& a, const FloatN& b) { return { std::bit_cast<float>((a.v < b.v) ? 0xFFFFFFFFu : 0u) }; }
+	inline uint32_t MoveMask(const FloatN& mask) { return std::bit_cast<uint32_t>(mask.v) >> 31; }
+	inline FloatN MaskFromBits(const uint32_t bits) { return { std::bit_cast<float>((bits & 1u) ? 0xFFFFFFFFu : 0u) }; }
+	inline FloatN Select(const FloatN& mask, const FloatN& a, const FloatN& b) { return (std::bit_cast<uint32_t>(mask.v) != 0) ? a : b; }
+
+	inline IntN Set1(const int32_t i) { return { i }; }
+	inline void Store(int32_t* pData, const IntN& a) { *pData = a.v; }
+	inline IntN TruncateToInt(const FloatN& a) { return { static_cast<int32_t>(a.v) }; }
+	inline IntN RoundToInt(const FloatN& a) { return { static_cast<int32_t>(std::nearbyint(a.v)) }; }
+	inline FloatN ToFloat(const IntN& a) { return { static_cast<float>(a.v) }; }
+	inline IntN AsInt(const FloatN& a) { return { std::bit_cast<int32_t>(a.v) }; }
+	inline FloatN AsFloat(const IntN& a) { return { std::bit_cast<float>(a.v) }; }
+
+	inline IntN operator+(const IntN& a, const IntN& b) { return { a.v + b.v }; }
+	inline IntN operator-(const IntN& a, const IntN& b) { return { a.v - b.v }; }
+	inline IntN operator&(const IntN& a, const IntN& b) { return { a.v & b.v }; }
+	inline IntN operator|(const IntN& a, const IntN& b) { return { a.v | b.v }; }
+	inline IntN operator*(const IntN& a, const IntN& b) { return { static_cast<int32_t>(static_cast<uint32_t>(a.v) * static_cast<uint32_t>(b.v)) }; }
+	inline IntN ShiftLeft(const IntN& a, const int count) { return { static_cast<int32_t>(static_cast<uint32_t>(a.v) << count) }; }
+	inline IntN ShiftRight(const IntN& a, const int count) { return { static_cast<int32_t>(static_cast<uint32_t>(a.v) >> count) }; }
+
+	inline IntN Gather(const uint32_t* pData, const IntN& x, const IntN& y, const int rowLength, const uint32_t laneMask)
+	{
+		return { (laneMask & 1u) ? static_cast<int32_t>(pData[y.v * rowLength + x.v]) : 0 };
+	}
+
+	inline Int64N Ramp(const int64_t start, const int64_t) { return { start }; }
+	inline Int64N Set1(const int64_t i) { return { i }; }
+	inline Int64N operator+(const Int64N& a, const Int64N& b) { return { a.v + b.v }; }
+	inline Int64N operator|(const Int64N& a, const Int64N& b) { return { a.v | b.v }; }
+	inline uint32_t SignMask(const Int64N& a) { return (a.v < 0) ? 1u : 0u; }
+
+#endif
+
+	constexpr uint32_t FullMask{ (1u << Width) - 1 };
+
+	inline FloatN Saturate(const FloatN& a) { return Min(Max(a, Set1(0.f)), Set1(1.f)); }
+	//round towards minus infinity, for values that fit an int
+	inline FloatN Floor(const FloatN& a)
+	{
+		const FloatN truncated{ ToFloat(TruncateToInt(a)) };
+		return Select(Less(a, truncated), truncated - Set1(1.f), truncated);
+	}
+	inline FloatN Lerp(const FloatN& a, const FloatN& b, const FloatN& factor) { return a + (b - a) * factor; }
+
+	//The scalar build runs the same polynomials as a lane would instead of log2f & powf, so it picks the same mip levels & highlights bit for bit
+	//log2 for positive normal numbers, cephes polynomial for log(1 + f) with the mantissa kept in [sqrt(.5), sqrt(2)[
+	inline FloatN Log2(const FloatN& a)
+	{
+		const IntN bits{ AsInt(a) };
+		FloatN exponent{ ToFloat(ShiftRight(bits, 23) - Set1(127)) };
+		FloatN mantissa{ AsFloat((bits & Set1(0x007FFFFF)) | Set1(0x3F800000)) };
+
+		const FloatN isAboveSqrt2{ Less(Set1(1.41421356f), mantissa) };
+		mantissa = Select(isAboveSqrt2, mantissa * Set1(.5f), mantissa);
+		exponent = exponent + Select(isAboveSqrt2, Set1(1.f), Set1(0.f));
+
+		const FloatN f{ mantissa - Set1(1.f) };
+		const FloatN f2{ f * f };
+
+		FloatN polynomial{ Set1(7.0376836292e-2f) };
+		polynomial = polynomial * f + Set1(-1.1514610310e-1f);
+		polynomial = polynomial * f + Set1(1.1676998740e-1f);
+		polynomial = polynomial * f + Set1(-1.2420140846e-1f);
+		polynomial = polynomial * f + Set1(1.4249322787e-1f);
+		polynomial = polynomial * f + Set1(-1.6668057665e-1f);
+		polynomial = polynomial * f + Set1(2.0000714765e-1f);
+		polynomial = polynomial * f + Set1(-2.4999993993e-1f);
+		polynomial = polynomial * f + Set1(3.3333331174e-1f);
+
+		const FloatN logMantissa{ f + (f * f2 * polynomial - Set1(.5f) * f2) };
+		return logMantissa * Set1(1.44269504089f) + exponent;
+	}
+	//2^a, cephes polynomial for the fraction, results below 2^-126 are flushed to that
+	inline FloatN Exp2(const FloatN& a)
+	{
+		const FloatN clamped{ Min(Max(a, Set1(-126.f)), Set1(126.f)) };
+		const IntN whole{ RoundToInt(clamped) };
+		const FloatN f{ clamped - ToFloat(whole) };
+
+		FloatN polynomial{ Set1(1.535336188319500e-4f) };
+		polynomial = polynomial * f + Set1(1.339887440266574e-3f);
+		polynomial = polynomial * f + Set1(9.618437357674640e-3f);
+		polynomial = polynomial * f + Set1(5.550332471162809e-2f);
+		polynomial = polynomial * f + Set1(2.402264791363012e-1f);
+		polynomial = polynomial * f + Set1(6.931472028550421e-1f);
+
+		const FloatN scale{ AsFloat(ShiftLeft(whole + Set1(127), 23)) };
+		return (Set1(1.f) + f * polynomial) * scale;
+	}
+	//powf for base in [0, 1], within a few ulp of it
+	inline FloatN Pow(const FloatN& base, const FloatN& exponent)
+	{
+		const FloatN power{ Exp2(exponent * Log2(base)) };
+
+		//log2 is undefined at 0, handle it like powf does
+		const FloatN zero{ Set1(0.f) };
+		const FloatN powerOfZero{ Select(Less(zero, exponent), zero, Set1(1.f)) };
+		return Select(Less(zero, base), power, powerOfZero);
+	}
+
+	//Structure of arrays versions of the math types, one element per lane
+	struct Vector2N { FloatN x, y; };
+	struct Vector3N { FloatN x, y, z; };
+	struct ColorRGBN { FloatN r, g, b; };
+
+	inline FloatN Dot(const Vector3N& a, const Vector3N& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline Vector3N Cross(const Vector3N& a, const Vector3N& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+	inline Vector3N Normalized(const Vector3N& a)
+	{
+		const FloatN magnitude{ Sqrt(a.x * a.x + a.y * a.y + a.z * a.z) };
+		return { a.x / magnitude, a.y / magnitude, a.z / magnitude };
+	}
+
+	inline ColorRGBN operator+(const ColorRGBN& a, const ColorRGBN& b) { return { a.r + b.r, a.g + b.g, a.b + b.b }; }
+	inline ColorRGBN operator*(const ColorRGBN& a, const FloatN& s) { return { a.r * s, a.g * s, a.b * s }; }
+	inline ColorRGBN operator/(const ColorRGBN& a, const FloatN& s) { return { a.r / s, a.g / s, a.b / s }; }
+	inline ColorRGBN Lerp(const ColorRGBN& a, const ColorRGBN& b, const FloatN& factor) { return { Lerp(a.r, b.r, factor), Lerp(a.g, b.g, factor), Lerp(a.b, b.b, factor) }; }
+	inline ColorRGBN Select(const FloatN& mask, const ColorRGBN& a, const ColorRGBN& b) { return { Select(mask, a.r, b.r), Select(mask, a.g, b.g), Select(mask, a.b, b.b) }; }
+
+	inline Vector3N operator+(const Vector3N& a, const Vector3N& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	inline Vector3N operator/(const Vector3N& a, const FloatN& s) { return { a.x / s, a.y / s, a.z / s }; }
+	inline Vector3N Lerp(const Vector3N& a, const Vector3N& b, const FloatN& factor) { return { Lerp(a.x, b.x, factor), Lerp(a.y, b.y, factor), Lerp(a.z, b.z, factor) }; }
+	inline Vector3N Select(const FloatN& mask, const Vector3N& a, const Vector3N& b) { return { Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z) }; }
+}
@@ -1,18 +1,104 @@
 #include "pch.h"
 #include "Texture.h"
+#include <bit>
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface, ID3D11Device* pDevice)
-		: m_pSurface{ pSurface }
-		, m_pSurfacePixels{ static_cast<uint32_t*>(pSurface->pixels) }
+	//2x2 box filter, Width texels of the smaller level at once
+	//odd sizes drop their last row or column, like the box filter of D3DX
+	static void DownsampleBox(const uint32_t* pSource, const int sourceWidth, const int sourceHeight, uint32_t* pDestination, const int width, const int height)
 	{
-		//Create Resource
+		using namespace SIMD;
+
+		//a side that's already 1 texel wide averages that texel with itself
+		const int nextX{ sourceWidth > 1 ? 1 : 0 };
+		const int nextY{ sourceHeight > 1 ? 1 : 0 };
+		const IntN laneIdx{ TruncateToInt(LaneIndex()) };
+		const IntN channelMask{ Set1(0xFF) };
+
+		for (int y{}; y < height; ++y)
+		{
+			const IntN row0{ Set1(y * 2) };
+			const IntN row1{ Set1(y * 2 + nextY) };
+
+			for (int x{}; x < width; x += Width)
+			{
+				const int nrLanes{ std::min(Width, width - x) };
+				const uint32_t laneMask{ FullMask >> (Width - nrLanes) };
+
+				const IntN column0{ ShiftLeft(Set1(x) + laneIdx, 1) };
+				const IntN column1{ column0 + Set1(nextX) };
+
+				const IntN texels[4]
+				{
+					Gather(pSource, column0, row0, sourceWidth, laneMask),
+					Gather(pSource, column1, row0, sourceWidth, laneMask),
+					Gather(pSource, column0, row1, sourceWidth, laneMask),
+					Gather(pSource, column1, row1, sourceWidth, laneMask)
+				};
+
+				//average every channel on its own, rounded to nearest
+				IntN average{ Set1(0) };
+				for (int channelShift{}; channelShift < 32; channelShift += 8)
+				{
+					IntN sum{ Set1(2) };
+					for (const IntN& texel : texels)
+					{
+						sum = sum + (ShiftRight(texel, channelShift) & channelMask);
+					}
+					average = average | ShiftLeft(ShiftRight(sum, 2), channelShift);
+				}
+
+				int32_t averages[Width]{};
+				Store(averages, average);
+				std::copy_n(averages, nrLanes, reinterpret_cast<int32_t*>(pDestination) + static_cast<size_t>(y) * width + x);
+			}
+		}
+	}
+
+	//what the filters do with a material, every map on its own
+	static MaterialN operator+(const MaterialN& a, const MaterialN& b)
+	{
+		return MaterialN{ a.diffuse + b.diffuse, a.normal + b.normal, a.specular + b.specular, a.glossiness + b.glossiness };
+	}
+	static MaterialN operator/(const MaterialN& a, const SIMD::FloatN& s)
+	{
+		return MaterialN{ a.diffuse / s, a.normal / s, a.specular / s, a.glossiness / s };
+	}
+	static MaterialN Lerp(const MaterialN& a, const MaterialN& b, const SIMD::FloatN& factor)
+	{
+		return MaterialN{ SIMD::Lerp(a.diffuse, b.diffuse, factor), SIMD::Lerp(a.normal, b.normal, factor), SIMD::Lerp(a.specular, b.specular, factor), SIMD::Lerp(a.glossiness, b.glossiness, factor) };
+	}
+	static MaterialN Select(const SIMD::FloatN& mask, const MaterialN& a, const MaterialN& b)
+	{
+		return MaterialN{ SIMD::Select(mask, a.diffuse, b.diffuse), SIMD::Select(mask, a.normal, b.normal), SIMD::Select(mask, a.specular, b.specular), SIMD::Select(mask, a.glossiness, b.glossiness) };
+	}
+
+	Texture::Texture(SDL_Surface* pSurface, ID3D11Device* pDevice, const TexelLayout layout, const TexelOrder order)
+		: m_Layout{ layout }
+		, m_Order{ order }
+		, m_Width{ pSurface->w }
+		, m_Height{ pSurface->h }
+		, m_IsPowerOfTwo{ std::has_single_bit(static_cast<uint32_t>(pSurface->w)) && std::has_single_bit(static_cast<uint32_t>(pSurface->h)) }
+	{
+		//Copy the texels out, rows of the surface may be padded
+		std::vector<uint32_t> packedTexels(static_cast<size_t>(m_Width) * m_Height);
+		for (int y{}; y < m_Height; ++y)
+		{
+			const uint32_t* pRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pSurface->pixels) + static_cast<size_t>(y) * pSurface->pitch) };
+			std::copy_n(pRow, m_Width, packedTexels.begin() + static_cast<size_t>(y) * m_Width);
+		}
+		SDL_FreeSurface(pSurface);
+
+		GenerateMips(packedTexels);
+		const uint32_t nrMipLevels{ static_cast<uint32_t>(m_MipOffsets.size()) };
+
+		//Create Resource, with every mip level
 		DXGI_FORMAT format{ DXGI_FORMAT_R8G8B8A8_UNORM };
 		D3D11_TEXTURE2D_DESC desc{};
-		desc.Width = pSurface->w;
-		desc.Height = pSurface->h;
-		desc.MipLevels = 1;
+		desc.Width = m_Width;
+		desc.Height = m_Height;
+		desc.MipLevels = nrMipLevels;
 		desc.ArraySize = 1;
 		desc.Format = format;
 		desc.SampleDesc.Count = 1;
@@ -22,12 +108,19 @@ namespace dae
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
 
-		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = pSurface->pixels;
-		initData.SysMemPitch = static_cast<UINT>(pSurface->pitch);
-		initData.SysMemSlicePitch = static_cast<UINT>(pSurface->h * pSurface->pitch);
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(nrMipLevels);
+		for (uint32_t level{}; level < nrMipLevels; ++level)
+		{
+			initData[level].pSysMem = packedTexels.data() + m_MipOffsets[level];
+			initData[level].SysMemPitch = m_MipWidths[level] * sizeof(uint32_t);
+			initData[level].SysMemSlicePitch = m_MipWidths[level] * m_MipHeights[level] * sizeof(uint32_t);
+		}
+
+		HRESULT hr{ pDevice->CreateTexture2D(&desc, initData.data(), &m_pResource) };
+
+		//Keep the row major chain around to bake a material out of, the sampler only ever reads materials
+		m_PackedTexels = std::move(packedTexels);
 
-		HRESULT hr{ pDevice->CreateTexture2D(&desc, &initData, &m_pResource) };
 		if (FAILED(hr))
 			return;
 
@@ -35,7 +128,7 @@ namespace dae
 		D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 		SRVDesc.Format = format;
 		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		SRVDesc.Texture2D.MipLevels = 1;
+		SRVDesc.Texture2D.MipLevels = nrMipLevels;
 
 		hr = pDevice->CreateShaderResourceView(m_pResource, &SRVDesc, &m_pSRV);
 		if (FAILED(hr))
@@ -48,41 +141,442 @@ namespace dae
 			m_pSRV->Release();
 		if (m_pResource)
 			m_pResource->Release();
-
-		if (m_pSurface)
-		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
-		}
 	}
 
-	Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice)
+	Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice, const TexelLayout layout, const TexelOrder order)
 	{
 		//Load SDL_Surface using IMG_LOAD
+		SDL_Surface* pLoadedSurface{ IMG_Load(path.c_str()) };
+
+		//Convert to bytes in R, G, B, A order, which is what both the sampler & DXGI_FORMAT_R8G8B8A8_UNORM expect whatever the file held
+		SDL_Surface* pSurface{ SDL_ConvertSurfaceFormat(pLoadedSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+		SDL_FreeSurface(pLoadedSurface);
+
 		//Create & Return a new Texture Object (using SDL_Surface)
-		Texture* temp{ new Texture{ IMG_Load(path.c_str()), pDevice } };
+		Texture* temp{ new Texture{ pSurface, pDevice, layout, order } };
 
 		return temp;
 	}
 
-	ColorRGB Texture::Sample(const Vector2& uv) const
+	Texture* Texture::BakeMaterial(const Texture* pDiffuse, const Texture* pNormal, const Texture* pSpecular, const Texture* pGlossiness, const MaterialFactors& factors)
+	{
+		return new Texture{ pDiffuse, pNormal, pSpecular, pGlossiness, factors };
+	}
+
+	Texture::Texture(const Texture* pDiffuse, const Texture* pNormal, const Texture* pSpecular, const Texture* pGlossiness, const MaterialFactors& factors)
+		: m_Layout{ pDiffuse->m_Layout }
+		, m_Order{ pDiffuse->m_Order }
+		, m_Width{ pDiffuse->m_Width }
+		, m_Height{ pDiffuse->m_Height }
+		, m_IsPowerOfTwo{ pDiffuse->m_IsPowerOfTwo }
+		, m_MaterialFactors{ factors }
+		, m_MipWidths{ pDiffuse->m_MipWidths }
+		, m_MipHeights{ pDiffuse->m_MipHeights }
+	{
+		//the maps already have their mip chains, so the material is made of those, level by level in the row major order GenerateMips uses
+		const Texture* pMaps[m_NrMaterialMaps]{ pDiffuse, pNormal, pSpecular, pGlossiness };
+		const size_t nrMipLevels{ m_MipWidths.size() };
+
+		//a map of another size than the diffuse map is resampled to it, every level out of the map's level closest in size (nearest texel)
+		int mapLevelShifts[m_NrMaterialMaps]{};
+		for (int mapIdx{}; mapIdx < m_NrMaterialMaps; ++mapIdx)
+		{
+			mapLevelShifts[mapIdx] = static_cast<int>(std::lround(std::log2(static_cast<float>(pMaps[mapIdx]->m_Width) / static_cast<float>(m_Width))));
+		}
+
+		std::vector<uint32_t> records{};
+		m_MipOffsets.resize(nrMipLevels);
+		for (size_t level{}; level < nrMipLevels; ++level)
+		{
+			m_MipOffsets[level] = static_cast<uint32_t>(records.size() / m_NrMaterialMaps);
+
+			for (uint32_t row{}; row < m_MipHeights[level]; ++row)
+			{
+				for (uint32_t column{}; column < m_MipWidths[level]; ++column)
+				{
+					for (int mapIdx{}; mapIdx < m_NrMaterialMaps; ++mapIdx)
+					{
+						const Texture* pMap{ pMaps[mapIdx] };
+						if (pMap->m_Width == m_Width && pMap->m_Height == m_Height)
+						{
+							records.push_back(pMap->GetPackedTexel(level, column, row));
+							continue;
+						}
+
+						const int lastMapLevel{ static_cast<int>(pMap->m_MipWidths.size()) - 1 };
+						const size_t mapLevel{ static_cast<size_t>(std::clamp(static_cast<int>(level) + mapLevelShifts[mapIdx], 0, lastMapLevel)) };
+						const uint64_t mapWidth{ pMap->m_MipWidths[mapLevel] };
+						const uint64_t mapHeight{ pMap->m_MipHeights[mapLevel] };
+
+						//the map texel under the center of the material texel
+						const uint32_t mapColumn{ static_cast<uint32_t>((2 * column + 1) * mapWidth / (2 * m_MipWidths[level])) };
+						const uint32_t mapRow{ static_cast<uint32_t>((2 * row + 1) * mapHeight / (2 * m_MipHeights[level])) };
+						records.push_back(pMap->GetPackedTexel(mapLevel, mapColumn, mapRow));
+					}
+				}
+			}
+		}
+
+		StoreTexels(records);
+	}
+
+	void Texture::GenerateMips(std::vector<uint32_t>& texels)
+	{
+		m_MipWidths.assign(1, m_Width);
+		m_MipHeights.assign(1, m_Height);
+		m_MipOffsets.assign(1, 0);
+
+		while (m_MipWidths.back() > 1 || m_MipHeights.back() > 1)
+		{
+			const uint32_t sourceWidth{ m_MipWidths.back() };
+			const uint32_t sourceHeight{ m_MipHeights.back() };
+			const uint32_t sourceOffset{ m_MipOffsets.back() };
+
+			const uint32_t width{ std::max(sourceWidth / 2, 1u) };
+			const uint32_t height{ std::max(sourceHeight / 2, 1u) };
+			const uint32_t offset{ sourceOffset + sourceWidth * sourceHeight };
+
+			texels.resize(static_cast<size_t>(offset) + width * height);
+			DownsampleBox(texels.data() + sourceOffset, sourceWidth, sourceHeight, texels.data() + offset, width, height);
+
+			m_MipWidths.push_back(width);
+			m_MipHeights.push_back(height);
+			m_MipOffsets.push_back(offset);
+		}
+	}
+
+	void Texture::StoreTexels(const std::vector<uint32_t>& texels)
+	{
+		//the mip chain is tightly packed in row major order with a record of m_NrMaterialMaps texels each, give every level its place in m_Order
+		const std::vector<uint32_t> sourceOffsets{ std::move(m_MipOffsets) };
+		const size_t nrMipLevels{ m_MipWidths.size() };
+		m_MipPitches.resize(nrMipLevels);
+		m_MipOffsets.resize(nrMipLevels);
+
+		size_t nrTexels{};
+		for (size_t level{}; level < nrMipLevels; ++level)
+		{
+			uint32_t nrRows{ m_MipHeights[level] };
+			m_MipPitches[level] = m_MipWidths[level];
+
+			//a row of tiles gets one extra tile, tiles above each other would otherwise be a power of two apart & fight over the same cache sets
+			if (m_Order == TexelOrder::TILED)
+			{
+				nrRows = (nrRows + m_TileSize - 1) >> m_TileSizeBits;
+				m_MipPitches[level] = (((m_MipWidths[level] + m_TileSize - 1) >> m_TileSizeBits) + 1) * m_TileSize * m_TileSize;
+			}
+
+			m_MipOffsets[level] = static_cast<uint32_t>(nrTexels);
+			nrTexels += static_cast<size_t>(nrRows) * m_MipPitches[level];
+		}
+
+		//the vector only promises the alignment of its elements, so the first level gets moved up to the next cache line
+		constexpr size_t cacheLineSize{ 64 };
+		const size_t texelSize{ m_NrMaterialMaps * ((m_Layout == TexelLayout::MATERIAL32F) ? 4 * sizeof(float) : sizeof(uint32_t)) };
+		nrTexels += std::max(cacheLineSize / texelSize, size_t{ 1 });
+
+		const void* pTexels{};
+		if (m_Layout == TexelLayout::MATERIAL32F)
+		{
+			m_FloatTexels.resize(nrTexels * m_NrMaterialMaps * 4);
+			pTexels = m_FloatTexels.data();
+		}
+		else
+		{
+			m_PackedTexels.resize(nrTexels * m_NrMaterialMaps);
+			pTexels = m_PackedTexels.data();
+		}
+
+		//what FetchTexels would do to every map of a material record, done once here when it's kept in floats
+		const float materialScales[m_NrMaterialMaps]{ m_MaterialFactors.diffuse, 2.f, 1.f, m_MaterialFactors.glossiness };
+		const float materialBiases[m_NrMaterialMaps]{ 0.f, -1.f, 0.f, 0.f };
+
+		//a float material record is a whole cache line, so it's moved by floats instead
+		const size_t address{ reinterpret_cast<uintptr_t>(pTexels) };
+		const size_t alignmentBytes{ (cacheLineSize - address % cacheLineSize) % cacheLineSize };
+		const uint32_t firstTexel{ static_cast<uint32_t>(alignmentBytes / texelSize) };
+		if (m_Layout == TexelLayout::MATERIAL32F)
+			m_FirstFloat = alignmentBytes / sizeof(float);
+		for (uint32_t& offset : m_MipOffsets)
+		{
+			offset += firstTexel;
+		}
+
+		for (size_t level{}; level < nrMipLevels; ++level)
+		{
+			for (uint32_t row{}; row < m_MipHeights[level]; ++row)
+			{
+				for (uint32_t column{}; column < m_MipWidths[level]; ++column)
+				{
+					const size_t sourceIdx{ sourceOffsets[level] + static_cast<size_t>(row) * m_MipWidths[level] + column };
+					const size_t texelIdx{ GetTexelIdx(level, column, row) };
+
+					if (m_Layout == TexelLayout::MATERIAL)
+					{
+						std::copy_n(texels.begin() + sourceIdx * m_NrMaterialMaps, m_NrMaterialMaps, m_PackedTexels.begin() + texelIdx * m_NrMaterialMaps);
+						continue;
+					}
+
+					for (int mapIdx{}; mapIdx < m_NrMaterialMaps; ++mapIdx)
+					{
+						const uint32_t texel{ texels[sourceIdx * m_NrMaterialMaps + mapIdx] };
+						for (int channelIdx{}; channelIdx < 4; ++channelIdx)
+						{
+							const float channel{ static_cast<float>((texel >> (channelIdx * 8)) & 0xFF) / 255.f };
+							m_FloatTexels[m_FirstFloat + (texelIdx * m_NrMaterialMaps + mapIdx) * 4 + channelIdx] = channel * materialScales[mapIdx] + materialBiases[mapIdx];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	size_t Texture::GetTexelIdx(const size_t level, const uint32_t column, const uint32_t row) const
+	{
+		if (m_Order == TexelOrder::ROW_MAJOR)
+			return m_MipOffsets[level] + static_cast<size_t>(row) * m_MipPitches[level] + column;
+
+		//row of tiles, tile inside of that row, then the texel inside of the tile
+		constexpr uint32_t tileMask{ m_TileSize - 1 };
+		return m_MipOffsets[level] + static_cast<size_t>(row >> m_TileSizeBits) * m_MipPitches[level]
+			+ ((column >> m_TileSizeBits) << (2 * m_TileSizeBits)) + ((row & tileMask) << m_TileSizeBits) + (column & tileMask);
+	}
+	uint32_t Texture::GetPackedTexel(const size_t level, const uint32_t column, const uint32_t row) const
+	{
+		//a map keeps the row major chain GenerateMips made
+		return m_PackedTexels[m_MipOffsets[level] + static_cast<size_t>(row) * m_MipWidths[level] + column];
+	}
+
+	MaterialN Texture::FetchTexels(const SIMD::IntN& texelIdx, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		static_assert(m_NrMaterialMaps == 4);
+		const IntN zero{ Set1(0) };
+
+		//every channel is a float of its own & already decoded, a record is 4 texels of 4 floats that fill a cache line
+		if (m_Layout == TexelLayout::MATERIAL32F)
+		{
+			const uint32_t* pTexels{ reinterpret_cast<const uint32_t*>(m_FloatTexels.data() + m_FirstFloat) };
+			const IntN channelIdx{ ShiftLeft(texelIdx, 4) };
+			const auto gatherChannel{ [&](const int mapIdx, const int channel)
+				{
+					return AsFloat(Gather(pTexels + mapIdx * 4 + channel, channelIdx, zero, 0, laneMask));
+				} };
+
+			return MaterialN{
+				ColorRGBN{ gatherChannel(0, 0), gatherChannel(0, 1), gatherChannel(0, 2) },
+				Vector3N{ gatherChannel(1, 0), gatherChannel(1, 1), gatherChannel(1, 2) },
+				ColorRGBN{ gatherChannel(2, 0), gatherChannel(2, 1), gatherChannel(2, 2) },
+				gatherChannel(3, 0)
+			};
+		}
+
+		//the texels of a record share a cache line, only the first of these gathers can miss
+		const IntN recordIdx{ ShiftLeft(texelIdx, 2) };
+		const IntN diffuse{ Gather(m_PackedTexels.data(), recordIdx, zero, 0, laneMask) };
+		const IntN normal{ Gather(m_PackedTexels.data() + 1, recordIdx, zero, 0, laneMask) };
+		const IntN specular{ Gather(m_PackedTexels.data() + 2, recordIdx, zero, 0, laneMask) };
+		const IntN glossiness{ Gather(m_PackedTexels.data() + 3, recordIdx, zero, 0, laneMask) };
+
+		//the factors & the normal's [0, 1] => [-1, 1] ride along with the scale that normalizes the bytes anyway
+		//red is the lowest byte so it only needs the mask
+		static_assert(m_RedShift == 0);
+		const IntN channelMask{ Set1(0xFF) };
+		const FloatN diffuseScale{ Set1(m_MaterialFactors.diffuse / 255.f) };
+		const FloatN normalScale{ Set1(2.f / 255.f) };
+		const FloatN unormScale{ Set1(1.f / 255.f) };
+		const FloatN one{ Set1(1.f) };
+		return MaterialN{
+			ColorRGBN{
+				ToFloat(diffuse & channelMask) * diffuseScale,
+				ToFloat(ShiftRight(diffuse, m_GreenShift) & channelMask) * diffuseScale,
+				ToFloat(ShiftRight(diffuse, m_BlueShift) & channelMask) * diffuseScale
+			},
+			Vector3N{
+				ToFloat(normal & channelMask) * normalScale - one,
+				ToFloat(ShiftRight(normal, m_GreenShift) & channelMask) * normalScale - one,
+				ToFloat(ShiftRight(normal, m_BlueShift) & channelMask) * normalScale - one
+			},
+			ColorRGBN{
+				ToFloat(specular & channelMask) * unormScale,
+				ToFloat(ShiftRight(specular, m_GreenShift) & channelMask) * unormScale,
+				ToFloat(ShiftRight(specular, m_BlueShift) & channelMask) * unormScale
+			},
+			ToFloat(glossiness & channelMask) * Set1(m_MaterialFactors.glossiness / 255.f)
+		};
+	}
+
+	MaterialN Texture::SampleMaterial(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy, const uint32_t laneMask) const
+	{
+		return SampleFiltered(sampler, uv, uvDdx, uvDdy, laneMask);
+	}
+
+	MaterialN Texture::SampleFiltered(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		//squared lengths of the pixel's footprint along x & y, in texels of level 0
+		const FloatN width{ Set1(static_cast<float>(m_Width)) };
+		const FloatN height{ Set1(static_cast<float>(m_Height)) };
+		const FloatN ddxX{ uvDdx.x * width };
+		const FloatN ddxY{ uvDdx.y * height };
+		const FloatN ddyX{ uvDdy.x * width };
+		const FloatN ddyY{ uvDdy.y * height };
+		const FloatN ddxLength{ ddxX * ddxX + ddxY * ddxY };
+		const FloatN ddyLength{ ddyX * ddyX + ddyY * ddyY };
+
+		if (sampler.filter == SamplerState::ANISOTROPIC)
+			return SampleAnisotropic(sampler, uv, uvDdx, uvDdy, ddxLength, ddyLength, laneMask);
+
+		//the longest side picks the level, log2 of its square halved saves the square root
+		const FloatN lod{ Set1(.5f) * Log2(Max(Max(ddxLength, ddyLength), Set1(FLT_MIN))) };
+
+		if (sampler.filter == SamplerState::POINT)
+			return SamplePoint(sampler, uv, lod, laneMask);
+
+		return SampleTrilinear(sampler, uv, lod, laneMask);
+	}
+	MaterialN Texture::SamplePoint(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& lod, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		//nearest level & nearest texel
+		const FloatN maxLevel{ Set1(static_cast<float>(m_MipOffsets.size() - 1)) };
+		const MipLevelN level{ GetMipLevel(Min(Max(Floor(lod + Set1(.5f)), Set1(0.f)), maxLevel), laneMask) };
+
+		const IntN column{ AddressTexels(Floor(uv.x * ToFloat(level.width)), level.width, sampler.addressMode) };
+		const IntN row{ AddressTexels(Floor(uv.y * ToFloat(level.height)), level.height, sampler.addressMode) };
+
+		return FetchTexels(GetTexelIdx(level, column, row), laneMask);
+	}
+	MaterialN Texture::SampleBilinear(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& level, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		const MipLevelN mipLevel{ GetMipLevel(level, laneMask) };
+
+		//texel centers sit at half texels, so the 4 taps are the texels around uv - half a texel
+		const FloatN x{ uv.x * ToFloat(mipLevel.width) - Set1(.5f) };
+		const FloatN y{ uv.y * ToFloat(mipLevel.height) - Set1(.5f) };
+		const FloatN x0{ Floor(x) };
+		const FloatN y0{ Floor(y) };
+		const FloatN factorX{ x - x0 };
+		const FloatN factorY{ y - y0 };
+
+		const FloatN one{ Set1(1.f) };
+		const IntN column0{ AddressTexels(x0, mipLevel.width, sampler.addressMode) };
+		const IntN column1{ AddressTexels(x0 + one, mipLevel.width, sampler.addressMode) };
+		const IntN row0{ AddressTexels(y0, mipLevel.height, sampler.addressMode) };
+		const IntN row1{ AddressTexels(y0 + one, mipLevel.height, sampler.addressMode) };
+
+		const MaterialN top{ Lerp(FetchTexels(GetTexelIdx(mipLevel, column0, row0), laneMask), FetchTexels(GetTexelIdx(mipLevel, column1, row0), laneMask), factorX) };
+		const MaterialN bottom{ Lerp(FetchTexels(GetTexelIdx(mipLevel, column0, row1), laneMask), FetchTexels(GetTexelIdx(mipLevel, column1, row1), laneMask), factorX) };
+		return Lerp(top, bottom, factorY);
+	}
+	MaterialN Texture::SampleTrilinear(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& lod, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		const FloatN maxLevel{ Set1(static_cast<float>(m_MipOffsets.size() - 1)) };
+		const FloatN clampedLod{ Min(Max(lod, Set1(0.f)), maxLevel) };
+
+		const FloatN level0{ Floor(clampedLod) };
+		const FloatN levelFactor{ clampedLod - level0 };
+
+		const MaterialN color0{ SampleBilinear(sampler, uv, level0, laneMask) };
+
+		//magnified or exactly on a level, the next level wouldn't add anything
+		if ((MoveMask(Less(Set1(0.f), levelFactor)) & laneMask) == 0)
+			return color0;
+
+		const MaterialN color1{ SampleBilinear(sampler, uv, Min(level0 + Set1(1.f), maxLevel), laneMask) };
+		return Lerp(color0, color1, levelFactor);
+	}
+	MaterialN Texture::SampleAnisotropic(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy,
+		const SIMD::FloatN& ddxLength, const SIMD::FloatN& ddyLength, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		//the footprint is stretched along its longest side, spread trilinear samples along that side
+		//each one only has to cover the shortest side, so they come from a sharper level than a single sample would
+		const FloatN isAlongX{ NotLess(ddxLength, ddyLength) };
+		const FloatN majorLength{ Max(Select(isAlongX, ddxLength, ddyLength), Set1(FLT_MIN)) };
+		const FloatN minorLength{ Max(Select(isAlongX, ddyLength, ddxLength), Set1(FLT_MIN)) };
+		const Vector2N majorAxis{ Select(isAlongX, uvDdx.x, uvDdy.x), Select(isAlongX, uvDdx.y, uvDdy.y) };
+
+		const FloatN ratio{ Min(Sqrt(majorLength / minorLength), Set1(static_cast<float>(sampler.maxAnisotropy))) };
+		const FloatN nrSamples{ -Floor(-ratio) };
+		const FloatN lod{ Set1(.5f) * Log2(majorLength) - Log2(nrSamples) };
+
+		//lanes stop taking samples once they have their own number of them
+		float laneNrSamples[Width]{};
+		Store(laneNrSamples, nrSamples);
+
+		int maxNrSamples{ 1 };
+		for (uint32_t remainingMask{ laneMask }; remainingMask != 0; remainingMask &= remainingMask - 1)
+		{
+			maxNrSamples = std::max(maxNrSamples, static_cast<int>(laneNrSamples[std::countr_zero(remainingMask)]));
+		}
+
+		MaterialN color{};
+		for (int sampleIdx{}; sampleIdx < maxNrSamples; ++sampleIdx)
+		{
+			const FloatN sampleIdxN{ Set1(static_cast<float>(sampleIdx)) };
+			const uint32_t sampleMask{ laneMask & MoveMask(Less(sampleIdxN, nrSamples)) };
+
+			//evenly spaced over the footprint, centered on uv
+			const FloatN offset{ (sampleIdxN + Set1(.5f)) / nrSamples - Set1(.5f) };
+			const Vector2N sampleUV{ uv.x + majorAxis.x * offset, uv.y + majorAxis.y * offset };
+
+			const MaterialN sample{ SampleTrilinear(sampler, sampleUV, lod, sampleMask) };
+			color = Select(MaskFromBits(sampleMask), color + sample, color);
+		}
+
+		return color / nrSamples;
+	}
+	Texture::MipLevelN Texture::GetMipLevel(const SIMD::FloatN& level, const uint32_t laneMask) const
+	{
+		using namespace SIMD;
+
+		const IntN levelIdx{ TruncateToInt(level) };
+		const IntN zero{ Set1(0) };
+		return MipLevelN{
+			Gather(m_MipWidths.data(), levelIdx, zero, 0, laneMask),
+			Gather(m_MipHeights.data(), levelIdx, zero, 0, laneMask),
+			Gather(m_MipPitches.data(), levelIdx, zero, 0, laneMask),
+			Gather(m_MipOffsets.data(), levelIdx, zero, 0, laneMask)
+		};
+	}
+	SIMD::IntN Texture::GetTexelIdx(const MipLevelN& level, const SIMD::IntN& column, const SIMD::IntN& row) const
+	{
+		using namespace SIMD;
+
+		if (m_Order == TexelOrder::ROW_MAJOR)
+			return level.offset + row * level.pitch + column;
+
+		//same as the scalar version, every lane in its own level
+		const IntN tileMask{ Set1(m_TileSize - 1) };
+		return level.offset + ShiftRight(row, m_TileSizeBits) * level.pitch
+			+ ShiftLeft(ShiftRight(column, m_TileSizeBits), 2 * m_TileSizeBits) + ShiftLeft(row & tileMask, m_TileSizeBits) + (column & tileMask);
+	}
+	SIMD::IntN Texture::AddressTexels(const SIMD::FloatN& coordinate, const SIMD::IntN& size, const TextureAddressMode addressMode) const
 	{
-		//Sample the correct texel for the given uv
-		//calculate current pixel to sample
-		const int x{ static_cast<int>(uv.x * static_cast<float>(m_pSurface->w)) };
-		const int y{ static_cast<int>(uv.y * static_cast<float>(m_pSurface->h)) };
+		using namespace SIMD;
 
-		const Uint32 pixelIdx{ m_pSurfacePixels[(y * m_pSurface->w) + x] };
+		//coordinate is a whole texel, it may lie outside of the level
+		const FloatN sizeF{ ToFloat(size) };
+		const FloatN maxCoordinate{ sizeF - Set1(1.f) };
 
-		//get RGB-values from the texture for the current pixel
-		Uint8 r{};
-		Uint8 g{};
-		Uint8 b{};
+		if (addressMode == TextureAddressMode::CLAMP)
+			return TruncateToInt(Min(Max(coordinate, Set1(0.f)), maxCoordinate));
 
-		SDL_GetRGB(pixelIdx, m_pSurface->format, &r, &g, &b);
+		//two's complement makes the mask wrap negative coordinates too
+		if (m_IsPowerOfTwo)
+			return TruncateToInt(coordinate) & (size - Set1(1));
 
-		//get RGB-values in [0, 1] range instead of [0, 255]
-		constexpr float maxValue{ 255.f };
-		return ColorRGB{ static_cast<float>(r) / maxValue, static_cast<float>(g) / maxValue, static_cast<float>(b) / maxValue };
+		//the clamp only catches rounding & coordinates too far out to be whole numbers anymore
+		const FloatN wrapped{ coordinate - Floor(coordinate / sizeF) * sizeF };
+		return TruncateToInt(Min(Max(wrapped, Set1(0.f)), maxCoordinate));
 	}
 }
@@ -2,6 +2,37 @@
 
 namespace dae
 {
+	//How the software sampler keeps the texels of a material, a fixed layout so sampling never goes through SDL
+	//the maps are only loaded to be baked, they keep their RGBA8 texels & pass the layout on to the material baked out of them
+	enum class TexelLayout
+	{
+		MATERIAL, //16 bytes per texel, the RGBA8 texels of the diffuse, normal, specular & glossiness maps next to each other, decoded with shifts & masks
+		MATERIAL32F, //64 bytes per texel, the same 4 texels in floats with the factors & the normal's [-1, 1] already applied, a fetch is all there is to it
+	};
+
+	//In what order the software sampler keeps the texels of every mip level
+	enum class TexelOrder
+	{
+		ROW_MAJOR, //like the surface, neighbours above & below are a whole row away
+		TILED, //4x4 blocks stored one after another, so a footprint stays within a few cache lines whichever way uv runs over the screen
+	};
+
+	//Constant factors of the shading baked into a material, they scale the maps as they're decoded so shading doesn't have to
+	struct MaterialFactors
+	{
+		float diffuse{ 1.f }; //kd / PI * light intensity for Lambert
+		float glossiness{ 1.f }; //the shininess white stands for
+	};
+
+	//One material sample per SIMD lane, the factors are already applied & the normal is in [-1, 1] tangent space
+	struct MaterialN
+	{
+		SIMD::ColorRGBN diffuse{};
+		SIMD::Vector3N normal{};
+		SIMD::ColorRGBN specular{};
+		SIMD::FloatN glossiness{};
+	};
+
 	class Texture final
 	{
 	public:
@@ -12,8 +43,15 @@ namespace dae
 		Texture& operator=(const Texture&) = delete;
 		Texture& operator=(Texture&&) noexcept = delete;
 
-		static Texture* LoadFromFile(const std::string& path, ID3D11Device* pDevice);
-		ColorRGB Sample(const Vector2& uv) const;
+		//layout & order are the ones a material baked out of the map (as its diffuse map) gets
+		static Texture* LoadFromFile(const std::string& path, ID3D11Device* pDevice, const TexelLayout layout = TexelLayout::MATERIAL, const TexelOrder order = TexelOrder::ROW_MAJOR);
+		//Software only, interleaves the maps so sampling them is a single fetch
+		//the material takes the size, texel order & layout of the diffuse map, the other maps are resampled to its size when they differ
+		static Texture* BakeMaterial(const Texture* pDiffuse, const Texture* pNormal, const Texture* pSpecular, const Texture* pGlossiness, const MaterialFactors& factors);
+
+		//Samples a texture made by BakeMaterial at one uv per SIMD lane, only the lanes in laneMask touch the texture
+		//the mip level comes from how far uv moves to the next pixel in x (uvDdx) & in y (uvDdy)
+		MaterialN SampleMaterial(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy, const uint32_t laneMask) const;
 
 		ID3D11ShaderResourceView* GetSRV() const
 		{
@@ -21,14 +59,72 @@ namespace dae
 		}
 
 	private:
-		Texture(SDL_Surface* pSurface, ID3D11Device* pDevice);
+		//takes an RGBA32 surface & frees it once the texels are copied out, they're kept in the row major mip chain DirectX gets
+		Texture(SDL_Surface* pSurface, ID3D11Device* pDevice, const TexelLayout layout, const TexelOrder order);
+		Texture(const Texture* pDiffuse, const Texture* pNormal, const Texture* pSpecular, const Texture* pGlossiness, const MaterialFactors& factors);
 
 		//DirectX
 		ID3D11Texture2D* m_pResource{};
 		ID3D11ShaderResourceView* m_pSRV{};
 
 		//Software
-		SDL_Surface* m_pSurface{};
-		uint32_t* m_pSurfacePixels{};
+		TexelLayout m_Layout{};
+		TexelOrder m_Order{};
+		int m_Width{};
+		int m_Height{};
+		bool m_IsPowerOfTwo{}; //every level of a power of two texture is one too, so wrapping is a mask
+
+		//every mip level follows the one before it, level 0 is the texture itself
+		//a material's first level starts on a cache line, so no record ever straddles two
+		std::vector<uint32_t> m_PackedTexels{}; //RGBA8, red in the lowest byte, 1 per texel for a map & 4 for a TexelLayout::MATERIAL
+		std::vector<float> m_FloatTexels{}; //16 floats per texel of a TexelLayout::MATERIAL32F
+		size_t m_FirstFloat{}; //floats in front of the first material record, those can only be moved to a cache line by less than a texel
+
+		//Software - material
+		static constexpr int m_NrMaterialMaps{ 4 };
+		MaterialFactors m_MaterialFactors{};
+
+		//Software - mip chain, each level is half the size of the one before it (rounded down, at least 1) down to 1x1
+		//kept as separate tables so every lane can gather the size & start of its own level
+		std::vector<uint32_t> m_MipWidths{};
+		std::vector<uint32_t> m_MipHeights{};
+		std::vector<uint32_t> m_MipPitches{}; //texels from one row to the next, one row of tiles when tiled
+		std::vector<uint32_t> m_MipOffsets{}; //first texel of each level
+
+		//Software - tiles of TexelOrder::TILED, levels are padded to whole tiles
+		static constexpr int m_TileSizeBits{ 2 };
+		static constexpr int m_TileSize{ 1 << m_TileSizeBits };
+
+		//size, pitch & first texel of the level every lane samples
+		struct MipLevelN
+		{
+			SIMD::IntN width{};
+			SIMD::IntN height{};
+			SIMD::IntN pitch{};
+			SIMD::IntN offset{};
+		};
+
+		void GenerateMips(std::vector<uint32_t>& texels);
+		void StoreTexels(const std::vector<uint32_t>& texels);
+		size_t GetTexelIdx(const size_t level, const uint32_t column, const uint32_t row) const;
+		uint32_t GetPackedTexel(const size_t level, const uint32_t column, const uint32_t row) const;
+		SIMD::IntN GetTexelIdx(const MipLevelN& level, const SIMD::IntN& column, const SIMD::IntN& row) const;
+		MipLevelN GetMipLevel(const SIMD::FloatN& level, const uint32_t laneMask) const;
+		SIMD::IntN AddressTexels(const SIMD::FloatN& coordinate, const SIMD::IntN& size, const TextureAddressMode addressMode) const;
+
+		//the filters below all end up here, one decoded material record per lane
+		MaterialN FetchTexels(const SIMD::IntN& texelIdx, const uint32_t laneMask) const;
+
+		MaterialN SampleFiltered(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy, const uint32_t laneMask) const;
+		MaterialN SamplePoint(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& lod, const uint32_t laneMask) const;
+		MaterialN SampleBilinear(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& level, const uint32_t laneMask) const;
+		MaterialN SampleTrilinear(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::FloatN& lod, const uint32_t laneMask) const;
+		MaterialN SampleAnisotropic(const SoftwareSampler& sampler, const SIMD::Vector2N& uv, const SIMD::Vector2N& uvDdx, const SIMD::Vector2N& uvDdy,
+			const SIMD::FloatN& ddxLength, const SIMD::FloatN& ddyLength, const uint32_t laneMask) const;
+
+		//position of the 8-bit color channels inside an RGBA8 texel, the same on every texture
+		static constexpr int m_RedShift{ 0 };
+		static constexpr int m_GreenShift{ 8 };
+		static constexpr int m_BlueShift{ 16 };
 	};
 }
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	ThreadPool::ThreadPool(uint32_t nrThreads)
+	{
+		//the calling thread always helps out, so only spawn the extra workers
+		nrThreads = std::max(nrThreads, 1u);
+
+		m_Workers.reserve(nrThreads - 1);
+		for (uint32_t workerIdx{}; workerIdx < nrThreads - 1; ++workerIdx)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, workerIdx);
+		}
+	}
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::ParallelFor(uint32_t nrJobs, const std::function<void(uint32_t)>& job, uint32_t maxThreads)
+	{
+		if (nrJobs == 0)
+			return;
+
+		const uint32_t nrWorkers{ std::min({ static_cast<uint32_t>(m_Workers.size()), std::max(maxThreads, 1u) - 1, nrJobs - 1 }) };
+
+		//not worth waking anyone up, run everything on the calling thread
+		if (nrWorkers == 0)
+		{
+			for (uint32_t jobIdx{}; jobIdx < nrJobs; ++jobIdx)
+			{
+				job(jobIdx);
+			}
+			return;
+		}
+
+		//publish the new batch
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pJob = &job;
+			m_NrJobs = nrJobs;
+			m_NextJobIdx.store(0);
+			m_NrActiveWorkers = nrWorkers;
+			m_NrBusyWorkers = nrWorkers;
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		RunJobs();
+
+		//wait for the workers to finish their last job
+		std::unique_lock lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_NrBusyWorkers == 0; });
+		m_pJob = nullptr;
+	}
+
+	void ThreadPool::WorkerLoop(uint32_t workerIdx)
+	{
+		uint64_t seenGeneration{};
+
+		while (true)
+		{
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [&] { return m_IsStopping || m_Generation != seenGeneration; });
+
+				if (m_IsStopping)
+					return;
+
+				seenGeneration = m_Generation;
+
+				//this batch doesn't need every worker
+				if (workerIdx >= m_NrActiveWorkers)
+					continue;
+			}
+
+			RunJobs();
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				--m_NrBusyWorkers;
+			}
+			m_DoneCondition.notify_one();
+		}
+	}
+	void ThreadPool::RunJobs()
+	{
+		for (uint32_t jobIdx{ m_NextJobIdx.fetch_add(1) }; jobIdx < m_NrJobs; jobIdx = m_NextJobIdx.fetch_add(1))
+		{
+			(*m_pJob)(jobIdx);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+//Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace dae
+{
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(uint32_t nrThreads = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Runs job(0) ... job(nrJobs - 1) on at most maxThreads threads (the calling thread included) and waits for all of them to finish
+		void ParallelFor(uint32_t nrJobs, const std::function<void(uint32_t)>& job, uint32_t maxThreads = UINT32_MAX);
+
+		uint32_t GetNrThreads() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+	private:
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		const std::function<void(uint32_t)>* m_pJob{};
+		uint32_t m_NrJobs{};
+		std::atomic<uint32_t> m_NextJobIdx{};
+
+		uint32_t m_NrActiveWorkers{};
+		uint32_t m_NrBusyWorkers{};
+		uint64_t m_Generation{};
+		bool m_IsStopping{ false };
+
+		void WorkerLoop(uint32_t workerIdx);
+		void RunJobs();
+	};
+}
@@ -1,157 +1,496 @@
 #pragma once
 #include "pch.h"
-#include <fstream>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <charconv>
+#include <chrono>
+#include <cstring>
 
 namespace dae::Utils
 {
-	//Just parses vertices and indices
+	struct OBJParseStats
+	{
+		size_t nrFaceCorners{};
+		size_t nrVertices{}; //after welding
+		double parseMilliseconds{};
+		double weldMilliseconds{};
+		double tangentMilliseconds{};
+	};
+
+	//position, uv & normal index of a face corner, 0 when the corner doesn't have one
+	struct OBJVertexKey
+	{
+		uint32_t iPosition{};
+		uint32_t iTexCoord{};
+		uint32_t iNormal{};
+
+		bool operator==(const OBJVertexKey& other) const = default;
+	};
+	//Everything a line aligned chunk of the file adds, indices are the ones written in the file
+	//Relative (negative) indices can only be resolved once the chunks before it are counted, until then they're local & flagged
+	struct OBJChunk
+	{
+		static constexpr uint32_t relativeIndexFlag{ 0x80000000u };
+
+		std::vector<Vector3> positions{};
+		std::vector<Vector2> UVs{};
+		std::vector<Vector3> normals{};
+		std::vector<OBJVertexKey> faceCorners{}; //triangulated, in winding order
+		bool isValid{ true };
+	};
+
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
-	static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
+	static void SkipOBJSpaces(const char*& pCursor, const char* pEnd)
 	{
-		std::ifstream file(filename);
-		if (!file)
+		while (pCursor < pEnd && (*pCursor == ' ' || *pCursor == '\t' || *pCursor == '\r'))
+			++pCursor;
+	}
+	static bool ParseOBJFloat(const char*& pCursor, const char* pEnd, float& value)
+	{
+		SkipOBJSpaces(pCursor, pEnd);
+
+		//from_chars doesn't accept an explicit plus sign
+		if (pCursor < pEnd && *pCursor == '+')
+			++pCursor;
+
+		const auto [pNext, error]{ std::from_chars(pCursor, pEnd, value) };
+		if (error != std::errc{})
 			return false;
 
-		std::vector<Vector3> positions{};
-		std::vector<Vector3> normals{};
-		std::vector<Vector2> UVs{};
+		pCursor = pNext;
+		return true;
+	}
+	static bool ParseOBJIndex(const char*& pCursor, const char* pEnd, const size_t nrLocalElements, uint32_t& index)
+	{
+		int64_t value{};
+		const auto [pNext, error]{ std::from_chars(pCursor, pEnd, value) };
+		if (error != std::errc{} || value == 0)
+			return false;
 
-		vertices.clear();
-		indices.clear();
+		pCursor = pNext;
+
+		//negative indices count back from the last element read so far, that can reach into the chunks before this one
+		index = (value > 0) ? static_cast<uint32_t>(value) : (static_cast<uint32_t>(static_cast<int64_t>(nrLocalElements) + value + 1) | OBJChunk::relativeIndexFlag);
+		return true;
+	}
 
-		std::string sCommand;
-		// start a while iteration ending when the end of file is reached (ios::eof)
-		while (!file.eof())
+	//Parses the lines in [pBegin, pEnd[, pBegin has to be the start of a line
+	static void ParseOBJChunk(const char* pBegin, const char* pEnd, OBJChunk& chunk, bool flipAxisAndWinding)
+	{
+		std::vector<OBJVertexKey> polygon{};
+
+		for (const char* pLine{ pBegin }; pLine < pEnd && chunk.isValid;)
 		{
-			//read the first word of the string, use the >> operator (istream::operator>>) 
-			file >> sCommand;
-			//use conditional statements to process the different commands	
-			if (sCommand == "#")
-			{
-				// Ignore Comment
-			}
-			else if (sCommand == "v")
+			const char* pLineEnd{ static_cast<const char*>(memchr(pLine, '\n', static_cast<size_t>(pEnd - pLine))) };
+			if (!pLineEnd)
+				pLineEnd = pEnd;
+
+			const char* pCursor{ pLine };
+			pLine = pLineEnd + 1;
+
+			//read the first word of the line
+			SkipOBJSpaces(pCursor, pLineEnd);
+			const char* pCommand{ pCursor };
+			while (pCursor < pLineEnd && *pCursor != ' ' && *pCursor != '\t' && *pCursor != '\r')
+				++pCursor;
+
+			const std::string_view command{ pCommand, static_cast<size_t>(pCursor - pCommand) };
+
+			if (command == "v")
 			{
 				//Vertex
-				float x, y, z;
-				file >> x >> y >> z;
+				float x{}, y{}, z{};
+				chunk.isValid = ParseOBJFloat(pCursor, pLineEnd, x) && ParseOBJFloat(pCursor, pLineEnd, y) && ParseOBJFloat(pCursor, pLineEnd, z);
 
-				positions.emplace_back(x, y, z);
+				chunk.positions.emplace_back(x, y, z);
 			}
-			else if (sCommand == "vt")
+			else if (command == "vt")
 			{
 				// Vertex TexCoord
-				float u, v;
-				file >> u >> v;
-				UVs.emplace_back(u, 1 - v);
+				float u{}, v{};
+				chunk.isValid = ParseOBJFloat(pCursor, pLineEnd, u) && ParseOBJFloat(pCursor, pLineEnd, v);
+
+				chunk.UVs.emplace_back(u, 1 - v);
 			}
-			else if (sCommand == "vn")
+			else if (command == "vn")
 			{
 				// Vertex Normal
-				float x, y, z;
-				file >> x >> y >> z;
+				float x{}, y{}, z{};
+				chunk.isValid = ParseOBJFloat(pCursor, pLineEnd, x) && ParseOBJFloat(pCursor, pLineEnd, y) && ParseOBJFloat(pCursor, pLineEnd, z);
 
-				normals.emplace_back(x, y, z);
+				chunk.normals.emplace_back(x, y, z);
 			}
-			else if (sCommand == "f")
+			else if (command == "f")
 			{
-				//if a face is read:
-				//construct the 3 vertices, add them to the vertex array
-				//add three indices to the index array
-				//add the material index as attibute to the attribute array
-				//
-				// Faces or triangles
-				Vertex vertex{};
-				size_t iPosition, iTexCoord, iNormal;
+				// Faces, as position/uv/normal corners with optional uv & normal
+				polygon.clear();
 
-				uint32_t tempIndices[3];
-				for (size_t iFace = 0; iFace < 3; iFace++)
+				while (true)
 				{
-					// OBJ format uses 1-based arrays
-					file >> iPosition;
-					vertex.position = positions[iPosition - 1];
+					SkipOBJSpaces(pCursor, pLineEnd);
+					if (pCursor >= pLineEnd)
+						break;
+
+					OBJVertexKey key{};
+					if (!ParseOBJIndex(pCursor, pLineEnd, chunk.positions.size(), key.iPosition))
+					{
+						chunk.isValid = false;
+						break;
+					}
 
-					if ('/' == file.peek())//is next in buffer ==  '/' ?
+					if (pCursor < pLineEnd && *pCursor == '/')
 					{
-						file.ignore();//read and ignore one element ('/')
+						++pCursor;
 
-						if ('/' != file.peek())
+						// Optional texture coordinate
+						if (pCursor < pLineEnd && *pCursor != '/' && !ParseOBJIndex(pCursor, pLineEnd, chunk.UVs.size(), key.iTexCoord))
 						{
-							// Optional texture coordinate
-							file >> iTexCoord;
-							vertex.uv = UVs[iTexCoord - 1];
+							chunk.isValid = false;
+							break;
 						}
 
-						if ('/' == file.peek())
+						// Optional vertex normal
+						if (pCursor < pLineEnd && *pCursor == '/')
 						{
-							file.ignore();
-
-							// Optional vertex normal
-							file >> iNormal;
-							vertex.normal = normals[iNormal - 1];
+							++pCursor;
+							if (!ParseOBJIndex(pCursor, pLineEnd, chunk.normals.size(), key.iNormal))
+							{
+								chunk.isValid = false;
+								break;
+							}
 						}
 					}
 
-					vertices.push_back(vertex);
-					tempIndices[iFace] = static_cast<uint32_t>(vertices.size()) - 1;
-					//indices.push_back(static_cast<uint32_t>(vertices.size()) - 1);
+					polygon.push_back(key);
 				}
 
-				indices.push_back(tempIndices[0]);
-				if (flipAxisAndWinding) 
+				//a face needs at least a triangle, anything less is a broken file rather than one to skip
+				if (polygon.size() < 3)
 				{
-					indices.push_back(tempIndices[2]);
-					indices.push_back(tempIndices[1]);
+					chunk.isValid = false;
 				}
-				else
+
+				//polygons are split up as a fan around their first corner
+				for (size_t cornerIdx{ 1 }; cornerIdx + 1 < polygon.size(); ++cornerIdx)
 				{
-					indices.push_back(tempIndices[1]);
-					indices.push_back(tempIndices[2]);
+					chunk.faceCorners.push_back(polygon[0]);
+					if (flipAxisAndWinding)
+					{
+						chunk.faceCorners.push_back(polygon[cornerIdx + 1]);
+						chunk.faceCorners.push_back(polygon[cornerIdx]);
+					}
+					else
+					{
+						chunk.faceCorners.push_back(polygon[cornerIdx]);
+						chunk.faceCorners.push_back(polygon[cornerIdx + 1]);
+					}
 				}
 			}
-			//read till end of line and ignore all remaining chars
-			file.ignore(1000, '\n');
 		}
+	}
 
-		//Cheap Tangent Calculations
-		for (uint32_t i = 0; i < indices.size(); i += 3)
+	//Start of the first line at or after pPosition
+	static const char* FindOBJLineStart(const char* pPosition, const char* pEnd)
+	{
+		const char* pNewLine{ static_cast<const char*>(memchr(pPosition, '\n', static_cast<size_t>(pEnd - pPosition))) };
+		return pNewLine ? pNewLine + 1 : pEnd;
+	}
+
+	//Splits [pBegin, pEnd[ in nrChunks ranges of whole lines, chunk i is [chunkBegins[i], chunkBegins[i + 1][
+	static std::vector<const char*> SplitOBJLines(const char* pBegin, const char* pEnd, const uint32_t nrChunks)
+	{
+		const size_t size{ static_cast<size_t>(pEnd - pBegin) };
+
+		std::vector<const char*> chunkBegins(nrChunks + 1, pEnd);
+		chunkBegins[0] = pBegin;
+		for (uint32_t chunkIdx{ 1 }; chunkIdx < nrChunks; ++chunkIdx)
 		{
-			uint32_t index0 = indices[i];
-			uint32_t index1 = indices[static_cast<size_t>(i) + 1];
-			uint32_t index2 = indices[static_cast<size_t>(i) + 2];
-
-			const Vector3& p0 = vertices[index0].position;
-			const Vector3& p1 = vertices[index1].position;
-			const Vector3& p2 = vertices[index2].position;
-			const Vector2& uv0 = vertices[index0].uv;
-			const Vector2& uv1 = vertices[index1].uv;
-			const Vector2& uv2 = vertices[index2].uv;
-
-			const Vector3 edge0 = p1 - p0;
-			const Vector3 edge1 = p2 - p0;
-			const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
-			const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-			float r = 1.f / Vector2::Cross(diffX, diffY);
-
-			Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
-			vertices[index0].tangent += tangent;
-			vertices[index1].tangent += tangent;
-			vertices[index2].tangent += tangent;
+			chunkBegins[chunkIdx] = FindOBJLineStart(std::max(pBegin + size / nrChunks * chunkIdx, chunkBegins[chunkIdx - 1]), pEnd);
 		}
 
-		//Create the Tangents (reject)
-		for (auto& v : vertices)
+		return chunkBegins;
+	}
+
+	//Makes the relative indices of a chunk's corner absolute, given how many elements the chunks before it hold
+	static OBJVertexKey ResolveOBJVertexKey(OBJVertexKey key, const size_t positionOffset, const size_t UVOffset, const size_t normalOffset)
+	{
+		const auto resolveIndex{ [](uint32_t& index, const size_t offset)
+		{
+			if (index & OBJChunk::relativeIndexFlag)
+			{
+				//the local index is a 31 bit signed number, it's negative when pointing before this chunk
+				const int64_t globalIndex{ static_cast<int64_t>(offset) + (static_cast<int32_t>(index << 1) >> 1) };
+				index = (globalIndex > 0) ? static_cast<uint32_t>(globalIndex) : UINT32_MAX;
+			}
+		} };
+
+		resolveIndex(key.iPosition, positionOffset);
+		resolveIndex(key.iTexCoord, UVOffset);
+		resolveIndex(key.iNormal, normalOffset);
+		return key;
+	}
+
+	//Unnormalized tangent of a triangle, summed over every triangle sharing a vertex before being rejected from its normal
+	static Vector3 CalculateTriangleTangent(const Vertex& v0, const Vertex& v1, const Vertex& v2)
+	{
+		const Vector3 edge0 = v1.position - v0.position;
+		const Vector3 edge1 = v2.position - v0.position;
+		const Vector2 diffX = Vector2(v1.uv.x - v0.uv.x, v2.uv.x - v0.uv.x);
+		const Vector2 diffY = Vector2(v1.uv.y - v0.uv.y, v2.uv.y - v0.uv.y);
+		const float cross = Vector2::Cross(diffX, diffY);
+
+		//degenerate uvs have no tangent, it would come out inf or NaN & spread to every welded vertex the triangle shares
+		if (std::abs(cross) < 1e-12f)
+			return Vector3::Zero;
+
+		return (edge0 * diffY.y - edge1 * diffY.x) * (1.f / cross);
+	}
+
+	//Area weighted normal of a triangle, summed over every triangle sharing a vertex the OBJ gave no normal
+	//with isWindingFlipped the corners are already in flipped order while the positions aren't mirrored yet
+	static Vector3 CalculateTriangleNormal(const Vertex& v0, const Vertex& v1, const Vertex& v2, bool isWindingFlipped)
+	{
+		const Vector3 normal = Vector3::Cross(v1.position - v0.position, v2.position - v0.position);
+		return isWindingFlipped ? -normal : normal;
+	}
+
+	//Vertices without a normal (OBJ corners without one or an all zero vn) are the ones that get the summed triangle normals
+	static bool IsMissingNormal(const Vertex& vertex)
+	{
+		return vertex.normal.SqrMagnitude() == 0.f;
+	}
+
+	//Unit normal out of the summed triangle normals, vertices only used by degenerate triangles get any unit vector
+	static Vector3 FinishNormal(const Vector3& normal)
+	{
+		if (normal.SqrMagnitude() > 0.f)
+			return normal.Normalized();
+
+		return Vector3::UnitY;
+	}
+
+	//Unit tangent orthogonal to the normal out of the summed triangle tangents
+	//vertices only used by triangles with degenerate uvs get any vector orthogonal to the normal
+	static Vector3 FinishTangent(const Vector3& tangent, const Vector3& normal)
+	{
+		//without a normal there's nothing to be orthogonal to
+		if (normal.SqrMagnitude() == 0.f)
+			return tangent.SqrMagnitude() > 1e-12f ? tangent.Normalized() : Vector3::UnitX;
+
+		const Vector3 rejected = Vector3::Reject(tangent, normal);
+		if (rejected.SqrMagnitude() > 1e-12f)
+			return rejected.Normalized();
+
+		const Vector3 axis = std::abs(normal.x) < .9f ? Vector3::UnitX : Vector3::UnitY;
+		return Vector3::Cross(normal, axis).Normalized();
+	}
+
+	//Parses vertices and indices, the file is memory mapped & split in line aligned chunks that are parsed on the thread pool when given
+	static bool ParseOBJ(const std::string& filename, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true, OBJParseStats* pStats = nullptr, ThreadPool* pThreadPool = nullptr)
+	{
+		//a failed parse leaves both outputs empty, never half filled
+		vertices.clear();
+		indices.clear();
+		const auto fail{ [&vertices, &indices]()
+		{
+			vertices.clear();
+			indices.clear();
+			return false;
+		} };
+
+		const MappedFile file{ filename };
+		if (!file.IsValid())
+			return false;
+
+		const auto parallelFor{ [pThreadPool](uint32_t nrJobs, const std::function<void(uint32_t)>& job)
+		{
+			if (pThreadPool)
+			{
+				pThreadPool->ParallelFor(nrJobs, job);
+				return;
+			}
+			for (uint32_t jobIdx{}; jobIdx < nrJobs; ++jobIdx)
+			{
+				job(jobIdx);
+			}
+		} };
+
+		const auto parseStart{ std::chrono::high_resolution_clock::now() };
+
+		//1. Split the file in chunks that start at the beginning of a line, a few per thread so uneven chunks even out
+		constexpr size_t minChunkSize{ 1 << 20 };
+		const uint32_t nrThreads{ pThreadPool ? pThreadPool->GetNrThreads() : 1 };
+
+		const char* pFileBegin{ file.GetData() };
+		const char* pFileEnd{ pFileBegin + file.GetSize() };
+
+		const size_t maxNrChunks{ std::max<size_t>(file.GetSize() / minChunkSize, 1) };
+		const uint32_t nrChunks{ static_cast<uint32_t>(std::min<size_t>(maxNrChunks, static_cast<size_t>(nrThreads) * 4)) };
+
+		const std::vector<const char*> chunkBegins{ SplitOBJLines(pFileBegin, pFileEnd, nrChunks) };
+
+		std::vector<OBJChunk> chunks(nrChunks);
+		parallelFor(nrChunks, [&](uint32_t chunkIdx)
+			{
+				ParseOBJChunk(chunkBegins[chunkIdx], chunkBegins[chunkIdx + 1], chunks[chunkIdx], flipAxisAndWinding);
+			});
+
+		//2. Prefix sums give every chunk its place in the merged pools
+		std::vector<size_t> positionOffsets(nrChunks + 1);
+		std::vector<size_t> UVOffsets(nrChunks + 1);
+		std::vector<size_t> normalOffsets(nrChunks + 1);
+		std::vector<size_t> cornerOffsets(nrChunks + 1);
+		for (uint32_t chunkIdx{}; chunkIdx < nrChunks; ++chunkIdx)
+		{
+			if (!chunks[chunkIdx].isValid)
+				return fail();
+
+			positionOffsets[chunkIdx + 1] = positionOffsets[chunkIdx] + chunks[chunkIdx].positions.size();
+			UVOffsets[chunkIdx + 1] = UVOffsets[chunkIdx] + chunks[chunkIdx].UVs.size();
+			normalOffsets[chunkIdx + 1] = normalOffsets[chunkIdx] + chunks[chunkIdx].normals.size();
+			cornerOffsets[chunkIdx + 1] = cornerOffsets[chunkIdx] + chunks[chunkIdx].faceCorners.size();
+		}
+
+		std::vector<Vector3> positions(positionOffsets[nrChunks]);
+		std::vector<Vector2> UVs(UVOffsets[nrChunks]);
+		std::vector<Vector3> normals(normalOffsets[nrChunks]);
+		std::vector<OBJVertexKey> faceCorners(cornerOffsets[nrChunks]);
+
+		//3. Merge, every chunk copies into its own range & resolves its relative indices
+		parallelFor(nrChunks, [&](uint32_t chunkIdx)
+			{
+				OBJChunk& chunk{ chunks[chunkIdx] };
+
+				std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionOffsets[chunkIdx]);
+				std::copy(chunk.UVs.begin(), chunk.UVs.end(), UVs.begin() + UVOffsets[chunkIdx]);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalOffsets[chunkIdx]);
+
+				OBJVertexKey* pCorners{ faceCorners.data() + cornerOffsets[chunkIdx] };
+				for (size_t cornerIdx{}; cornerIdx < chunk.faceCorners.size(); ++cornerIdx)
+				{
+					pCorners[cornerIdx] = ResolveOBJVertexKey(chunk.faceCorners[cornerIdx], positionOffsets[chunkIdx], UVOffsets[chunkIdx], normalOffsets[chunkIdx]);
+				}
+
+				chunk = {};
+			});
+
+		const auto weldStart{ std::chrono::high_resolution_clock::now() };
+
+		//4. Weld corners with the same position, uv & normal into one vertex, so shared vertices only get transformed once
+		//every position keeps a chain of the vertices made from it, those chains are only longer than 1 on uv or normal seams
+		constexpr uint32_t endOfChain{ UINT32_MAX };
+		std::vector<uint32_t> firstVertexOfPosition(positions.size(), endOfChain);
+		std::vector<uint32_t> nextVertexOfPosition{};
+		std::vector<OBJVertexKey> vertexKeys{};
+		indices.reserve(faceCorners.size());
+
+		for (const OBJVertexKey& key : faceCorners)
 		{
-			v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+			//indices pointing outside of the pools
+			if (key.iPosition - 1 >= positions.size() || key.iTexCoord > UVs.size() || key.iNormal > normals.size())
+				return fail();
+
+			uint32_t vertexIdx{ firstVertexOfPosition[key.iPosition - 1] };
+			while (vertexIdx != endOfChain && !(vertexKeys[vertexIdx] == key))
+			{
+				vertexIdx = nextVertexOfPosition[vertexIdx];
+			}
+
+			if (vertexIdx == endOfChain)
+			{
+				vertexIdx = static_cast<uint32_t>(vertices.size());
+				nextVertexOfPosition.push_back(firstVertexOfPosition[key.iPosition - 1]);
+				firstVertexOfPosition[key.iPosition - 1] = vertexIdx;
+				vertexKeys.push_back(key);
+
+				Vertex vertex{};
+				vertex.position = positions[key.iPosition - 1];
+				if (key.iTexCoord != 0) vertex.uv = UVs[key.iTexCoord - 1];
+				if (key.iNormal != 0) vertex.normal = normals[key.iNormal - 1];
+
+				vertices.push_back(vertex);
+			}
+			indices.push_back(vertexIdx);
+		}
+
+		const auto tangentStart{ std::chrono::high_resolution_clock::now() };
+
+		//5. Cheap Tangent Calculations, every triangle is done in parallel & then accumulated over every triangle sharing the welded vertex
+		const size_t nrTriangles{ indices.size() / 3 };
+		constexpr size_t trianglesPerJob{ 1 << 16 };
+		const uint32_t nrTriangleJobs{ static_cast<uint32_t>((nrTriangles + trianglesPerJob - 1) / trianglesPerJob) };
+
+		//faces without normals get smooth ones out of the triangles around their vertices, before the tangents need them
+		const bool hasMissingNormals{ std::any_of(vertices.begin(), vertices.end(), IsMissingNormal) };
+
+		std::vector<Vector3> triangleTangents(nrTriangles);
+		std::vector<Vector3> triangleNormals(hasMissingNormals ? nrTriangles : 0);
+		parallelFor(nrTriangleJobs, [&](uint32_t jobIdx)
+			{
+				const size_t lastTriangle{ std::min(nrTriangles, (jobIdx + 1) * trianglesPerJob) };
+				for (size_t triangleIdx{ jobIdx * trianglesPerJob }; triangleIdx < lastTriangle; ++triangleIdx)
+				{
+					const Vertex& v0{ vertices[indices[triangleIdx * 3]] };
+					const Vertex& v1{ vertices[indices[triangleIdx * 3 + 1]] };
+					const Vertex& v2{ vertices[indices[triangleIdx * 3 + 2]] };
+					triangleTangents[triangleIdx] = CalculateTriangleTangent(v0, v1, v2);
+					if (hasMissingNormals)
+					{
+						triangleNormals[triangleIdx] = CalculateTriangleNormal(v0, v1, v2, flipAxisAndWinding);
+					}
+				}
+			});
 
-			if(flipAxisAndWinding)
+		//accumulating stays in triangle order, so the sums don't depend on the number of threads
+		std::vector<Vector3> vertexNormals(hasMissingNormals ? vertices.size() : 0);
+		for (size_t triangleIdx{}; triangleIdx < nrTriangles; ++triangleIdx)
+		{
+			for (size_t cornerIdx{}; cornerIdx < 3; ++cornerIdx)
 			{
-				v.position.z *= -1.f;
-				v.normal.z *= -1.f;
-				v.tangent.z *= -1.f;
+				const uint32_t vertexIdx{ indices[triangleIdx * 3 + cornerIdx] };
+				vertices[vertexIdx].tangent += triangleTangents[triangleIdx];
+				if (hasMissingNormals)
+				{
+					vertexNormals[vertexIdx] += triangleNormals[triangleIdx];
+				}
 			}
+		}
+
+		//Create the Tangents (reject)
+		constexpr size_t verticesPerJob{ 1 << 16 };
+		const uint32_t nrVertexJobs{ static_cast<uint32_t>((vertices.size() + verticesPerJob - 1) / verticesPerJob) };
+
+		parallelFor(nrVertexJobs, [&](uint32_t jobIdx)
+			{
+				const size_t lastVertex{ std::min(vertices.size(), (jobIdx + 1) * verticesPerJob) };
+				for (size_t vertexIdx{ jobIdx * verticesPerJob }; vertexIdx < lastVertex; ++vertexIdx)
+				{
+					Vertex& v{ vertices[vertexIdx] };
+					if (hasMissingNormals && IsMissingNormal(v))
+					{
+						v.normal = FinishNormal(vertexNormals[vertexIdx]);
+					}
+					v.tangent = FinishTangent(v.tangent, v.normal);
+
+					if (flipAxisAndWinding)
+					{
+						v.position.z *= -1.f;
+						v.normal.z *= -1.f;
+						v.tangent.z *= -1.f;
+					}
+				}
+			});
+
+		if (pStats)
+		{
+			const auto end{ std::chrono::high_resolution_clock::now() };
 
+			pStats->nrFaceCorners = faceCorners.size();
+			pStats->nrVertices = vertices.size();
+			pStats->parseMilliseconds = std::chrono::duration<double, std::milli>(weldStart - parseStart).count();
+			pStats->weldMilliseconds = std::chrono::duration<double, std::milli>(tangentStart - weldStart).count();
+			pStats->tangentMilliseconds = std::chrono::duration<double, std::milli>(end - tangentStart).count();
 		}
 
 		return true;
@@ -63,6 +63,9 @@ int main(const int argc, char* args[])
 				if (e.key.keysym.scancode == SDL_SCANCODE_F2) //Toggle rotation
 					pRenderer->ToggleShouldRotate();
 
+				if (e.key.keysym.scancode == SDL_SCANCODE_F4) //Cycle texture sampling state (point/linear/anisotropic)
+					pRenderer->CycleSamplerState();
+
 				if (e.key.keysym.scancode == SDL_SCANCODE_F9) //Cycle cull mode (back/front/none)
 					pRenderer->CycleCullMode();
 
@@ -76,9 +79,6 @@ int main(const int argc, char* args[])
 				{
 					if (e.key.keysym.scancode == SDL_SCANCODE_F3) //Toggle fireFX mesh
 						pRenderer->ToggleShouldRenderFireFX();
-
-					if (e.key.keysym.scancode == SDL_SCANCODE_F4) //Cycle texture sampling state (point/linear/anisotropic)
-						pRenderer->CycleSamplerState();
 				}
 				else //Software only
 				{
@@ -93,6 +93,12 @@ int main(const int argc, char* args[])
 
 					if (e.key.keysym.scancode == SDL_SCANCODE_F8) //Toggle bounding box
 						pRenderer->ToggleShouldShowBoundingBox();
+
+					if (e.key.keysym.scancode == SDL_SCANCODE_V) //Toggle visibility buffer (deferred shading)
+						pRenderer->ToggleIsUsingVisibilityBuffer();
+
+					if (e.key.keysym.scancode == SDL_SCANCODE_L) //Toggle lazy vertex transform (on demand, only what surviving triangles use)
+						pRenderer->ToggleIsTransformingLazily();
 				}
 
 				//Extra
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <sstream>
 #include <memory>
+#include <thread>
+#include <span>
 #define NOMINMAX  //for directx
 
 // SDL Headers